@@ -0,0 +1,119 @@
+#include "LogWrapper.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+
+Logger& Logger::getInstance() {
+    static Logger instance;
+    return instance;
+}
+
+void Logger::setLogFile(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.is_open()) {
+        file_.close();
+    }
+    file_.open(path, std::ios::app);
+    if (!file_.is_open()) {
+        std::fprintf(stderr, "无法打开日志文件: %s\n", path.c_str());
+    }
+}
+
+void Logger::log(LogLevel level, std::string_view message) {
+    if (!isEnabled(level)) {
+        return;
+    }
+
+    static const char* const LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    int millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()).count() % 1000);
+    std::tm local_time{};
+#ifdef _WIN32
+    localtime_s(&local_time, &seconds);
+#else
+    localtime_r(&seconds, &local_time);
+#endif
+
+    std::ostringstream line;
+    line << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(3) << std::setfill('0') << millis
+         << " [" << LEVEL_NAMES[static_cast<int>(level)] << "] " << message << '\n';
+    std::string text = line.str();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fwrite(text.data(), 1, text.size(), stderr);
+    if (file_.is_open()) {
+        file_ << text;
+        file_.flush();
+    }
+}
+
+namespace log_detail {
+
+bool nextPlaceholder(std::ostringstream& out, std::string_view& format, std::string& spec) {
+    size_t pos = 0;
+    while (pos < format.size()) {
+        char ch = format[pos];
+        if ((ch == '{' || ch == '}') && pos + 1 < format.size() && format[pos + 1] == ch) {
+            // {{和}}输出为单个花括号
+            out << ch;
+            pos += 2;
+            continue;
+        }
+        if (ch == '{') {
+            size_t end = format.find('}', pos);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            std::string_view inner = format.substr(pos + 1, end - pos - 1);
+            spec = inner.empty() || inner[0] != ':' ? std::string() : std::string(inner.substr(1));
+            format.remove_prefix(end + 1);
+            return true;
+        }
+        out << ch;
+        pos++;
+    }
+
+    out << format.substr(pos);
+    format = std::string_view();
+    return false;
+}
+
+void applySpec(std::ostringstream& out, const std::string& spec) {
+    size_t pos = 0;
+    if (pos < spec.size() && spec[pos] == '0') {
+        out << std::setfill('0') << std::internal;
+        pos++;
+    }
+
+    int width = 0;
+    while (pos < spec.size() && spec[pos] >= '0' && spec[pos] <= '9') {
+        width = width * 10 + (spec[pos++] - '0');
+    }
+    if (width > 0) {
+        out << std::setw(width);
+    }
+
+    if (pos < spec.size() && spec[pos] == '.') {
+        int precision = 0;
+        pos++;
+        while (pos < spec.size() && spec[pos] >= '0' && spec[pos] <= '9') {
+            precision = precision * 10 + (spec[pos++] - '0');
+        }
+        out << std::setprecision(precision);
+    }
+
+    if (pos < spec.size()) {
+        switch (spec[pos]) {
+            case 'f': out << std::fixed; break;
+            case 'x': out << std::hex; break;
+            case 'X': out << std::hex << std::uppercase; break;
+            default: break;
+        }
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// 日志级别（不使用ERROR作为名称：windows.h中ERROR是宏）
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERR
+};
+
+// 日志记录器：输出到标准错误，设置日志文件后同时追加到文件（多线程安全）
+class Logger {
+public:
+    static Logger& getInstance();
+
+    // 设置日志文件（追加写入），打开失败时只输出到标准错误
+    void setLogFile(const std::string& path);
+
+    // 设置最低输出级别
+    void setLevel(LogLevel level) { level_ = level; }
+
+    // 该级别的日志是否会输出
+    bool isEnabled(LogLevel level) const { return level >= level_; }
+
+    // 写入一条日志（带时间和级别前缀）
+    void log(LogLevel level, std::string_view message);
+
+private:
+    Logger() = default;
+
+    std::mutex mutex_;
+    std::ofstream file_;
+    LogLevel level_ = LogLevel::INFO;
+};
+
+namespace log_detail {
+
+// 输出format中下一个占位符之前的文本（处理{{和}}转义），占位符的格式说明写入spec
+// 没有更多占位符时输出剩余文本并返回false
+bool nextPlaceholder(std::ostringstream& out, std::string_view& format, std::string& spec);
+
+// 按格式说明设置流状态：[0][宽度][.精度][类型]，类型支持d、f、x、X、s
+void applySpec(std::ostringstream& out, const std::string& spec);
+
+inline void formatArgs(std::ostringstream& out, std::string_view& format) {
+    std::string spec;
+    while (nextPlaceholder(out, format, spec)) {
+        // 参数少于占位符时原样保留占位符
+        out << '{' << spec << '}';
+    }
+}
+
+template <typename T, typename... Rest>
+void formatArgs(std::ostringstream& out, std::string_view& format, const T& value, const Rest&... rest) {
+    std::string spec;
+    if (!nextPlaceholder(out, format, spec)) {
+        return;
+    }
+
+    std::ostringstream field;
+    field << std::boolalpha;
+    applySpec(field, spec);
+    if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>) {
+        // 单字节整数按数值输出
+        field << static_cast<int>(value);
+    }
+    else {
+        field << value;
+    }
+    out << field.str();
+    formatArgs(out, format, rest...);
+}
+
+}
+
+// 按{}占位符格式化日志消息
+template <typename... Args>
+std::string formatLog(std::string_view format, const Args&... args) {
+    std::ostringstream out;
+    log_detail::formatArgs(out, format, args...);
+    return out.str();
+}
+
+inline void logDebug(const std::string& message) { Logger::getInstance().log(LogLevel::DEBUG, message); }
+inline void logInfo(const std::string& message) { Logger::getInstance().log(LogLevel::INFO, message); }
+inline void logWarn(const std::string& message) { Logger::getInstance().log(LogLevel::WARN, message); }
+inline void logError(const std::string& message) { Logger::getInstance().log(LogLevel::ERR, message); }
+
+// 格式化版本：级别未启用时不格式化
+template <typename... Args>
+void logDebug_fmt(std::string_view format, const Args&... args) {
+    if (Logger::getInstance().isEnabled(LogLevel::DEBUG)) {
+        Logger::getInstance().log(LogLevel::DEBUG, formatLog(format, args...));
+    }
+}
+
+template <typename... Args>
+void logInfo_fmt(std::string_view format, const Args&... args) {
+    if (Logger::getInstance().isEnabled(LogLevel::INFO)) {
+        Logger::getInstance().log(LogLevel::INFO, formatLog(format, args...));
+    }
+}
+
+template <typename... Args>
+void logWarn_fmt(std::string_view format, const Args&... args) {
+    if (Logger::getInstance().isEnabled(LogLevel::WARN)) {
+        Logger::getInstance().log(LogLevel::WARN, formatLog(format, args...));
+    }
+}
+
+template <typename... Args>
+void logError_fmt(std::string_view format, const Args&... args) {
+    if (Logger::getInstance().isEnabled(LogLevel::ERR)) {
+        Logger::getInstance().log(LogLevel::ERR, formatLog(format, args...));
+    }
+}
@@ -0,0 +1,111 @@
+// 无窗口流水线性能测试：合成帧源 → 瓦片变化检测 → 图像编码 → 消息序列化
+// 用于在Linux构建机上测量捕获→编码→发送路径（不连接服务端，只构建消息）
+//
+// 用法: pipeline_bench [帧数] [编码器]
+//   帧数默认300，编码器默认为defaultImageEncoderName()
+//   依次测试1080p、1440p和4K，每个分辨率分别测试增量帧和全关键帧两种模式
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "capture_message.h"
+#include "frame_source.h"
+#include "image_encoder.h"
+#include "screen_capture.h"
+
+namespace {
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+struct BenchResult {
+    int frames = 0;                  // 捕获的帧数
+    int sent = 0;                    // 构建了消息的帧数（有变化的帧）
+    int keyframes = 0;               // 关键帧数
+    size_t message_bytes = 0;        // 消息总字节数
+    double seconds = 0.0;            // 总耗时
+};
+
+// 按客户端的方式运行frames帧：captureScreen后对有变化的结果构建image/image_delta消息
+bool runPipeline(const Resolution& resolution, const std::string& encoder, bool delta, int frames,
+                 BenchResult& result) {
+    auto source = std::make_unique<SyntheticFrameSource>();
+    if (!source->initialize(resolution.width, resolution.height, 0.0)) {
+        std::fprintf(stderr, "合成帧源初始化失败: %dx%d\n", resolution.width, resolution.height);
+        return false;
+    }
+
+    ScreenCapture capture;
+    capture.setFrameSource(std::move(source));
+    if (!capture.setEncoder(encoder) || !capture.initialize("pipeline_bench")) {
+        std::fprintf(stderr, "捕获器初始化失败，编码器: %s\n", encoder.c_str());
+        return false;
+    }
+    capture.setMinimumCaptureInterval(0);
+    capture.setResultPoolSize(4);
+    capture.setDeltaEncoding(delta, 30);
+
+    GameState game_state;
+    MessageBuffer message_buffer;
+    std::ostream json(&message_buffer);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        CaptureChange change;
+        std::shared_ptr<CaptureResult> capture_result = capture.captureScreen(80, change);
+        if (!capture_result) {
+            std::fprintf(stderr, "第%d帧捕获失败\n", i);
+            return false;
+        }
+        result.frames++;
+        if (!change.changed) {
+            continue;
+        }
+
+        message_buffer.clear();
+        writeCaptureMessage(json, *capture_result, game_state, i + 1);
+        result.sent++;
+        result.keyframes += capture_result->is_keyframe ? 1 : 0;
+        result.message_bytes += message_buffer.str().size();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    std::string encoder = argc > 2 ? argv[2] : defaultImageEncoderName();
+    if (frames <= 0) {
+        std::fprintf(stderr, "用法: %s [帧数] [编码器]\n", argv[0]);
+        return 1;
+    }
+
+    const Resolution resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+    };
+
+    std::printf("编码器: %s, 每项 %d 帧\n", encoder.c_str(), frames);
+    std::printf("%-6s %-9s %9s %10s %8s %8s %12s\n", "分辨率", "模式", "fps", "ms/帧", "消息数", "关键帧", "平均消息KB");
+    for (const Resolution& resolution : resolutions) {
+        for (bool delta : { true, false }) {
+            BenchResult result;
+            if (!runPipeline(resolution, encoder, delta, frames, result)) {
+                return 1;
+            }
+            double fps = result.frames / result.seconds;
+            double average_kb = result.sent > 0 ? result.message_bytes / 1024.0 / result.sent : 0.0;
+            std::printf("%-6s %-9s %9.1f %10.2f %8d %8d %12.1f\n", resolution.name, delta ? "delta" : "keyframe",
+                        fps, 1000.0 / fps, result.sent, result.keyframes, average_kb);
+        }
+    }
+    return 0;
+}
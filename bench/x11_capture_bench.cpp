@@ -0,0 +1,159 @@
+// X11 MIT-SHM捕获性能测试：创建测试窗口并绘制移动图案，用X11FrameSource连续捕获，输出帧率和延迟
+// 无显示器的构建机上配合Xvfb使用，例如:
+//   Xvfb :99 -screen 0 3840x2160x24 &
+//   DISPLAY=:99 x11_capture_bench 600
+//
+// 用法: x11_capture_bench [帧数] [display]
+//   依次测试1080p、1440p和4K窗口（超出屏幕尺寸的跳过）
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "frame_source.h"
+#include "x11_frame_source.h"
+
+// Xlib的宏（Status、None、Bool等）会与项目头文件冲突，放在项目头文件之后
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+namespace {
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+// 测试窗口：静态渐变条纹背景 + 每帧移动的方块
+class TestWindow {
+public:
+    TestWindow(Display* display, int width, int height, const std::string& title)
+        : display_(display), width_(width), height_(height) {
+        int screen = DefaultScreen(display_);
+        window_ = XCreateSimpleWindow(display_, RootWindow(display_, screen), 0, 0, width_, height_, 0,
+                                      BlackPixel(display_, screen), BlackPixel(display_, screen));
+        XStoreName(display_, window_, title.c_str());
+        XSelectInput(display_, window_, StructureNotifyMask);
+        gc_ = XCreateGC(display_, window_, 0, nullptr);
+        XMapWindow(display_, window_);
+
+        // 等待窗口映射完成，之后才能读取内容
+        XEvent event;
+        do {
+            XNextEvent(display_, &event);
+        } while (event.type != MapNotify);
+        drawBackground();
+    }
+
+    ~TestWindow() {
+        XFreeGC(display_, gc_);
+        XDestroyWindow(display_, window_);
+        XSync(display_, False);
+    }
+
+    // 擦除上一帧的方块并在新位置绘制
+    void drawFrame(int index) {
+        int size = height_ / 8;
+        int x = (index * 17) % (width_ - size);
+        int y = (index * 11) % (height_ - size);
+        drawStripes(box_x_, box_y_, size, size);
+        XSetForeground(display_, gc_, 0xE04020);
+        XFillRectangle(display_, window_, gc_, x, y, size, size);
+        XSync(display_, False);
+        box_x_ = x;
+        box_y_ = y;
+    }
+
+private:
+    void drawBackground() {
+        drawStripes(0, 0, width_, height_);
+        XSync(display_, False);
+    }
+
+    // 按列绘制渐变条纹（只重绘给定矩形）
+    void drawStripes(int x, int y, int width, int height) {
+        constexpr int STRIPE = 32;
+        for (int column = x / STRIPE * STRIPE; column < x + width; column += STRIPE) {
+            unsigned long level = static_cast<unsigned long>(column * 255 / width_);
+            XSetForeground(display_, gc_, (level << 16) | ((255 - level) << 8) | 0x60);
+            int left = std::max(column, x);
+            int right = std::min(column + STRIPE, x + width);
+            XFillRectangle(display_, window_, gc_, left, y, right - left, height);
+        }
+    }
+
+    Display* display_;
+    Window window_;
+    GC gc_;
+    int width_;
+    int height_;
+    int box_x_ = 0;
+    int box_y_ = 0;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    std::string display_name = argc > 2 ? argv[2] : "";
+    if (frames <= 0) {
+        std::fprintf(stderr, "用法: %s [帧数] [display]\n", argv[0]);
+        return 1;
+    }
+
+    Display* display = XOpenDisplay(display_name.empty() ? nullptr : display_name.c_str());
+    if (!display) {
+        std::fprintf(stderr, "无法连接X服务器（检查DISPLAY或先启动Xvfb）\n");
+        return 1;
+    }
+    int screen_width = DisplayWidth(display, DefaultScreen(display));
+    int screen_height = DisplayHeight(display, DefaultScreen(display));
+
+    const Resolution resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+    };
+
+    std::printf("屏幕: %dx%d, 每项 %d 帧\n", screen_width, screen_height, frames);
+    std::printf("%-6s %9s %12s %12s %12s\n", "分辨率", "fps", "平均延迟ms", "最长延迟ms", "含绘制fps");
+    for (const Resolution& resolution : resolutions) {
+        if (resolution.width > screen_width || resolution.height > screen_height) {
+            std::printf("%-6s 跳过（超出屏幕尺寸）\n", resolution.name);
+            continue;
+        }
+
+        std::string title = "x11_capture_bench " + std::string(resolution.name);
+        TestWindow window(display, resolution.width, resolution.height, title);
+
+        X11FrameSource source;
+        if (!source.initialize(title, display_name)) {
+            std::fprintf(stderr, "X11帧源初始化失败: %s\n", title.c_str());
+            XCloseDisplay(display);
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            window.drawFrame(i);
+            RawFrame frame;
+            if (!source.acquireFrame(frame)) {
+                std::fprintf(stderr, "第%d帧捕获失败\n", i);
+                XCloseDisplay(display);
+                return 1;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // fps按XShmGetImage耗时计算，含绘制fps为包括测试窗口绘制在内的整体循环速度
+        const X11FrameSource::CaptureStats& stats = source.getCaptureStats();
+        double average_ms = stats.total_us / 1000.0 / stats.frames;
+        std::printf("%-6s %9.1f %12.2f %12.2f %12.1f\n", resolution.name, 1000.0 / average_ms, average_ms,
+                    stats.max_us / 1000.0, frames / seconds);
+    }
+
+    XCloseDisplay(display);
+    return 0;
+}
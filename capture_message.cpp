@@ -0,0 +1,224 @@
+#include "capture_message.h"
+#include <algorithm>
+#include <ctime>
+
+void writeBase64(std::ostream& out, const uint8_t* data, size_t length) {
+    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char buffer[4096];
+    size_t pos = 0;
+    while (pos < length) {
+        size_t written = 0;
+        size_t end = std::min(length, pos + sizeof(buffer) / 4 * 3);
+        for (; pos + 3 <= end; pos += 3) {
+            uint32_t triple = (data[pos] << 16) | (data[pos + 1] << 8) | data[pos + 2];
+            buffer[written++] = chars[(triple >> 18) & 0x3F];
+            buffer[written++] = chars[(triple >> 12) & 0x3F];
+            buffer[written++] = chars[(triple >> 6) & 0x3F];
+            buffer[written++] = chars[triple & 0x3F];
+        }
+        if (pos < end) {
+            // 末尾不足3字节，用'='补齐
+            uint32_t triple = data[pos] << 16;
+            if (pos + 1 < end) triple |= data[pos + 1] << 8;
+            buffer[written++] = chars[(triple >> 18) & 0x3F];
+            buffer[written++] = chars[(triple >> 12) & 0x3F];
+            buffer[written++] = pos + 1 < end ? chars[(triple >> 6) & 0x3F] : '=';
+            buffer[written++] = '=';
+            pos = end;
+        }
+        out.write(buffer, written);
+    }
+}
+
+void writeJsonString(std::ostream& json, const std::string& value) {
+    static const char* hex = "0123456789abcdef";
+    json << '"';
+    // 不需要转义的连续字符整段写入
+    size_t start = 0;
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char ch = static_cast<unsigned char>(value[i]);
+        if (ch != '"' && ch != '\\' && ch >= 0x20) {
+            continue;
+        }
+        json.write(value.data() + start, i - start);
+        start = i + 1;
+        switch (ch) {
+            case '"': json << "\\\""; break;
+            case '\\': json << "\\\\"; break;
+            case '\n': json << "\\n"; break;
+            case '\r': json << "\\r"; break;
+            case '\t': json << "\\t"; break;
+            default: json << "\\u00" << hex[ch >> 4] << hex[ch & 0x0F]; break;
+        }
+    }
+    json.write(value.data() + start, value.size() - start);
+    json << '"';
+}
+
+void writePatch(std::ostream& json, const EncodedPatch& patch) {
+    json << "{";
+    if (!patch.name.empty()) {
+        json << "\"name\":";
+        writeJsonString(json, patch.name);
+        json << ",";
+    }
+    json << "\"x\":" << patch.rect.x << ",";
+    json << "\"y\":" << patch.rect.y << ",";
+    json << "\"w\":" << patch.rect.width << ",";
+    json << "\"h\":" << patch.rect.height << ",";
+    if (patch.encoded_width > 0 &&
+        (patch.encoded_width != patch.rect.width || patch.encoded_height != patch.rect.height)) {
+        // 缩放编码的区域，服务端需要按w/h放大
+        json << "\"ew\":" << patch.encoded_width << ",";
+        json << "\"eh\":" << patch.encoded_height << ",";
+    }
+    json << "\"data\":\"";
+    writeBase64(json, patch.data.data(), patch.data.size());
+    json << "\"";
+    json << "}";
+}
+
+size_t writePatches(std::ostream& json, const std::vector<EncodedPatch>& patches) {
+    size_t total_bytes = 0;
+    json << "[";
+    for (size_t i = 0; i < patches.size(); i++) {
+        if (i > 0) json << ",";
+        writePatch(json, patches[i]);
+        total_bytes += patches[i].data.size();
+    }
+    json << "]";
+    return total_bytes;
+}
+
+void writeGameState(std::ostream& json, const GameState& game_state) {
+    json << "\"game_state\":{";
+    json << "\"player_x\":" << game_state.player_x << ",";
+    json << "\"player_y\":" << game_state.player_y << ",";
+    json << "\"current_map\":";
+    writeJsonString(json, game_state.current_map);
+    json << ",";
+    json << "\"hp_percent\":" << game_state.hp_percent << ",";
+    json << "\"mp_percent\":" << game_state.mp_percent << ",";
+    json << "\"inventory_full\":" << (game_state.inventory_full ? "true" : "false");
+
+    // 添加技能冷却时间
+    json << ",\"cooldowns\":{";
+    bool first_cooldown = true;
+    for (const auto& cooldown : game_state.cooldowns) {
+        if (!first_cooldown) json << ",";
+        writeJsonString(json, cooldown.first);
+        json << ":" << cooldown.second;
+        first_cooldown = false;
+    }
+    json << "}";
+
+    json << "}";
+}
+
+void writeWindowRect(std::ostream& json, const RECT& window_rect) {
+    json << "\"window_rect\":["
+         << window_rect.left << ","
+         << window_rect.top << ","
+         << window_rect.right << ","
+         << window_rect.bottom
+         << "]";
+}
+
+const char* captureMessageType(const CaptureResult& result) {
+    return result.roi_only ? "image_roi"
+         : result.is_keyframe ? (result.content_cached ? "image_ref" : "image")
+         : result.is_pan ? "image_pan" : "image_delta";
+}
+
+size_t writeCaptureMessage(std::ostream& json, const CaptureResult& result, const GameState& game_state,
+                           int request_id) {
+    size_t total_bytes = 0;
+    json << "{";
+    json << "\"type\":\"" << captureMessageType(result) << "\",";
+    json << "\"request_id\":" << request_id << ",";
+    json << "\"timestamp\":" << std::time(nullptr) << ",";
+    json << "\"width\":" << result.width << ",";
+    json << "\"height\":" << result.height << ",";
+    if (result.source_width != result.width || result.source_height != result.height) {
+        // 整帧和增量区域按编码尺寸，关注区域按原始帧坐标
+        json << "\"source_width\":" << result.source_width << ",";
+        json << "\"source_height\":" << result.source_height << ",";
+    }
+
+    json << "\"frame_id\":" << result.frame_id << ",";
+    if (result.scene_change) {
+        // 场景切换，服务端应重置跟踪状态
+        json << "\"scene_change\":true,";
+    }
+    if (result.thumbnail) {
+        // 缩略图，服务端可用request_full_frame拉取全分辨率帧
+        json << "\"thumbnail\":true,";
+    }
+    if (result.luma_only) {
+        // 灰度图像（单通道亮度）
+        json << "\"color\":\"gray\",";
+    }
+    if (result.quality > 0) {
+        // 码率控制选择的JPEG质量
+        json << "\"quality\":" << result.quality << ",";
+    }
+    if (result.lossless) {
+        // 整帧和增量区域为QOI无损图像（关注区域仍为JPEG）
+        json << "\"format\":\"qoi\",";
+    }
+    if (!result.roi_only) {
+        json << "\"keyframe_id\":" << result.keyframe_id << ",";
+    }
+
+    if (result.roi_only) {
+        // 无整帧数据
+    }
+    else if (result.is_keyframe) {
+        if (!result.content_digest.empty()) {
+            // 服务端按摘要缓存关键帧并回复cache_ack；image_ref未命中时回复cache_miss
+            json << "\"content_hash\":\"" << result.content_digest.toHex() << "\",";
+        }
+        if (!result.content_cached) {
+            json << "\"data\":\"";
+            writeBase64(json, result.jpeg_data.data(), result.jpeg_data.size());
+            json << "\",";
+            total_bytes += result.jpeg_data.size();
+        }
+    }
+    else {
+        if (result.is_pan) {
+            // 服务端将上一帧平移后叠加patches，结果作为keyframe_id对应的新关键帧
+            json << "\"pan\":{\"dx\":" << result.pan_dx << ",\"dy\":" << result.pan_dy << "},";
+        }
+
+        // 添加变化区域
+        json << "\"patches\":";
+        total_bytes += writePatches(json, result.patches);
+        json << ",";
+    }
+
+    // 添加混合光栅的界面层：服务端解码整帧或增量区域后，把这些QOI无损图像覆盖到对应位置
+    if (!result.overlays.empty()) {
+        json << "\"overlays\":";
+        total_bytes += writePatches(json, result.overlays);
+        json << ",";
+    }
+
+    // 添加关注区域
+    if (!result.regions.empty()) {
+        json << "\"regions\":";
+        total_bytes += writePatches(json, result.regions);
+        json << ",";
+    }
+
+    // 添加游戏状态
+    writeGameState(json, game_state);
+    json << ",";
+
+    // 添加窗口矩形
+    writeWindowRect(json, result.window_rect);
+
+    json << "}";
+
+    return total_bytes;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "screen_capture.h"
+
+// 简化的GameState
+struct GameState {
+    int player_x = 0;
+    int player_y = 0;
+    std::string current_map = "";
+    float hp_percent = 100.0f;
+    float mp_percent = 100.0f;
+    bool inventory_full = false;
+    std::unordered_map<std::string, float> cooldowns;
+};
+
+// 消息缓冲区：ostream的输出追加到复用的字符串中，clear()保留容量，稳定状态下构建消息不再分配内存
+class MessageBuffer : public std::streambuf {
+public:
+    void clear() { data_.clear(); }
+    const std::string& str() const { return data_; }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            data_.push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override {
+        data_.append(s, static_cast<size_t>(count));
+        return count;
+    }
+
+private:
+    std::string data_;
+};
+
+// Base64编码直接写入输出流（分块编码到栈上缓冲区，不创建中间字符串）
+void writeBase64(std::ostream& out, const uint8_t* data, size_t length);
+
+// 写入带引号的JSON字符串：转义引号、反斜杠和控制字符（配置中的名称等外部文本必须经过此函数）
+void writeJsonString(std::ostream& json, const std::string& value);
+
+// 写入游戏状态JSON对象
+void writeGameState(std::ostream& json, const GameState& game_state);
+
+// 写入单个编码区域JSON对象
+void writePatch(std::ostream& json, const EncodedPatch& patch);
+
+// 写入编码区域JSON数组，返回图像数据总字节数
+size_t writePatches(std::ostream& json, const std::vector<EncodedPatch>& patches);
+
+// 写入窗口矩形JSON数组
+void writeWindowRect(std::ostream& json, const RECT& window_rect);
+
+// 捕获结果的消息类型：只有关注区域时为image_roi，否则按关键帧/平移帧/增量帧，服务端已缓存的关键帧为image_ref
+const char* captureMessageType(const CaptureResult& result);
+
+// 写入捕获结果消息（服务端在关键帧上依次覆盖各区域即可重建当前帧），返回图像数据总字节数
+size_t writeCaptureMessage(std::ostream& json, const CaptureResult& result, const GameState& game_state,
+                           int request_id);
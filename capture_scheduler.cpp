@@ -0,0 +1,72 @@
+#include "capture_scheduler.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <cmath>
+
+AdaptiveCaptureScheduler::AdaptiveCaptureScheduler()
+    : interval_ms_(500), idle_count_(0), minimized_(false) {
+    configure(CaptureSchedulerConfig());
+}
+
+void AdaptiveCaptureScheduler::configure(const CaptureSchedulerConfig& config) {
+    config_ = config;
+    config_.min_interval_ms = std::max(config_.min_interval_ms, 10);
+    config_.max_interval_ms = std::max(config_.max_interval_ms, config_.min_interval_ms);
+    config_.base_interval_ms = std::min(std::max(config_.base_interval_ms, config_.min_interval_ms),
+                                        config_.max_interval_ms);
+    config_.backoff_factor = std::max(config_.backoff_factor, 1.0);
+    if (config_.high_motion_ratio <= config_.idle_motion_ratio) {
+        config_.high_motion_ratio = config_.idle_motion_ratio + 0.01;
+    }
+
+    interval_ms_ = config_.base_interval_ms;
+    idle_count_ = 0;
+    minimized_ = false;
+
+    logInfo_fmt("自适应捕获间隔: {}-{} 毫秒（常规 {} 毫秒）",
+        config_.min_interval_ms, config_.max_interval_ms, config_.base_interval_ms);
+}
+
+void AdaptiveCaptureScheduler::onCapture(double motion_ratio, bool changed) {
+    minimized_ = false;
+
+    if (!changed || motion_ratio < config_.idle_motion_ratio) {
+        // 静止：指数退避
+        idle_count_++;
+        int backoff = static_cast<int>(std::min<double>(interval_ms_ * config_.backoff_factor,
+                                                        config_.max_interval_ms));
+        setInterval(std::max(backoff, config_.base_interval_ms), "静止");
+        return;
+    }
+
+    idle_count_ = 0;
+
+    if (motion_ratio >= config_.high_motion_ratio) {
+        setInterval(config_.min_interval_ms, "高运动");
+        return;
+    }
+
+    // 介于静止和高运动之间：在常规间隔和最短间隔之间线性插值
+    double t = (motion_ratio - config_.idle_motion_ratio) /
+               (config_.high_motion_ratio - config_.idle_motion_ratio);
+    int interval = static_cast<int>(std::lround(
+        config_.base_interval_ms + (config_.min_interval_ms - config_.base_interval_ms) * t));
+    setInterval(interval, "运动");
+}
+
+void AdaptiveCaptureScheduler::onMinimized() {
+    if (!minimized_) {
+        logInfo("游戏窗口已最小化，降低捕获频率");
+    }
+    minimized_ = true;
+    idle_count_++;
+    setInterval(config_.max_interval_ms, "最小化");
+}
+
+void AdaptiveCaptureScheduler::setInterval(int interval_ms, const char* reason) {
+    interval_ms = std::min(std::max(interval_ms, config_.min_interval_ms), config_.max_interval_ms);
+    if (interval_ms != interval_ms_) {
+        logDebug_fmt("捕获间隔: {} -> {} 毫秒（{}）", interval_ms_, interval_ms, reason);
+        interval_ms_ = interval_ms;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// 自适应捕获调度参数
+struct CaptureSchedulerConfig {
+    int min_interval_ms = 100;       // 最短捕获间隔（高运动场景，如战斗）
+    int base_interval_ms = 500;      // 常规捕获间隔
+    int max_interval_ms = 5000;      // 最长捕获间隔（静止、最小化、加载画面）
+    double high_motion_ratio = 0.15; // 脏瓦片比例达到该值时使用最短间隔
+    double idle_motion_ratio = 0.01; // 脏瓦片比例低于该值视为静止
+    double backoff_factor = 2.0;     // 静止时间隔的指数退避倍数
+};
+
+// 自适应捕获调度器：根据场景运动量调整捕获间隔
+// 运动量大时立即提高到最短间隔；静止（或只有加载进度条等微小变化）时按指数退避到最长间隔
+class AdaptiveCaptureScheduler {
+public:
+    AdaptiveCaptureScheduler();
+
+    // 设置调度参数（会重置当前间隔）
+    void configure(const CaptureSchedulerConfig& config);
+
+    // 记录一次捕获结果：motion_ratio为相对上一帧的脏瓦片比例，changed为是否有明显变化
+    void onCapture(double motion_ratio, bool changed);
+
+    // 记录窗口最小化（无法捕获）
+    void onMinimized();
+
+    // 当前捕获间隔（毫秒）
+    int intervalMs() const { return interval_ms_; }
+
+    // 连续静止的捕获次数
+    int idleCount() const { return idle_count_; }
+
+private:
+    // 更新间隔并在档位变化时记录日志
+    void setInterval(int interval_ms, const char* reason);
+
+    CaptureSchedulerConfig config_;
+    int interval_ms_;                // 当前间隔
+    int idle_count_;                 // 连续静止次数
+    bool minimized_;                 // 上次是否最小化
+};
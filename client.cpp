@@ -1,8 +1,13 @@
 #include "client.h"
 #include "LogWrapper.h"
+#include <algorithm>
+#include <cmath>
 #include <chrono>
+#include <cstdio>
+#include <ctime>
 #include <thread>
 #include <iostream>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -15,6 +20,10 @@
 #include <random>
 #include <nlohmann/json.hpp>
 
+#ifdef HAVE_X11_CAPTURE
+#include "x11_frame_source.h"
+#endif
+
 // 使用nlohmann-json库进行JSON处理
 using json = nlohmann::json;
 
@@ -24,6 +33,9 @@ const std::string DEFAULT_WINDOW_TITLE = "地下城与勇士";
 const double DEFAULT_CAPTURE_INTERVAL = 0.5;
 const int DEFAULT_IMAGE_QUALITY = 80;
 
+// 发送线程积压的非主帧消息上限（超出时丢弃最旧的消息）
+const size_t MAX_PENDING_MESSAGES = 64;
+
 // 状态常量
 enum class ClientState {
     DISCONNECTED,
@@ -46,14 +58,22 @@ const std::map<ClientState, std::string> STATE_NAMES = {
 
 DNFAutoClient::DNFAutoClient()
     : current_state_(ClientState::DISCONNECTED),
+      recorder_dump_count_(0),
       running_(false),
+      send_failures_(0),
+      last_sent_keyframe_id_(-1),
+      last_sent_frame_id_(-1),
+      pending_burst_request_id_(0),
+      burst_pending_(false),
       retry_count_(0),
       reconnect_delay_(0),
       action_counter_(0),
       last_action_time_(0),
       last_capture_time_(0),
+      next_capture_time_(0),
+      next_scene_probe_time_(0),
       last_image_hash_(0),
-      image_change_threshold_(5000),
+      image_change_threshold_(5),
       consecutive_errors_(0) {
 
     // 加载配置
@@ -108,6 +128,11 @@ void DNFAutoClient::ClientConfig::load_from_file(const std::string& filename) {
             std::string key = line.substr(0, delimiter_pos);
             std::string value = line.substr(delimiter_pos + 1);
 
+            // 删除行内注释
+            size_t comment_pos = value.find(';');
+            if (comment_pos != std::string::npos)
+                value.erase(comment_pos);
+
             // 删除键和值的空白字符
             key.erase(0, key.find_first_not_of(" \t"));
             if (key.length() > 0)
@@ -123,8 +148,120 @@ void DNFAutoClient::ClientConfig::load_from_file(const std::string& filename) {
             else if (current_section == "Capture") {
                 if (key == "interval") try { capture_interval = std::stod(value); }
                 catch (...) {}
+                else if (key == "adaptive") adaptive_capture = (value == "true" || value == "1");
+                else if (key == "min_interval") try { min_capture_interval = std::stod(value); }
+                catch (...) {}
+                else if (key == "max_interval") try { max_capture_interval = std::stod(value); }
+                catch (...) {}
+                else if (key == "high_motion_ratio") try { high_motion_ratio = std::stod(value); }
+                catch (...) {}
+                else if (key == "idle_motion_ratio") try { idle_motion_ratio = std::stod(value); }
+                catch (...) {}
                 else if (key == "quality") try { image_quality = std::stoi(value); }
                 catch (...) {}
+                else if (key == "target_frame_bytes") try { target_frame_bytes = std::stoi(value); }
+                catch (...) {}
+                else if (key == "rate_min_quality") try { rate_min_quality = std::stoi(value); }
+                catch (...) {}
+                else if (key == "rate_max_quality") try { rate_max_quality = std::stoi(value); }
+                catch (...) {}
+                else if (key == "tile_size") try { tile_size = std::stoi(value); }
+                catch (...) {}
+                else if (key == "change_threshold") try { change_threshold = std::stoi(value); }
+                catch (...) {}
+                else if (key == "change_noise_floor") try { change_noise_floor = std::stoi(value); }
+                catch (...) {}
+                else if (key == "cursor_mask") cursor_mask = (value == "true" || value == "1");
+                else if (key == "cursor_mask_size") try { cursor_mask_size = std::stoi(value); }
+                catch (...) {}
+                else if (key == "cursor_mask_paint") cursor_mask_paint = (value == "true" || value == "1");
+                else if (key == "delta_encoding") delta_encoding = (value == "true" || value == "1");
+                else if (key == "keyframe_interval") try { keyframe_interval = std::stoi(value); }
+                catch (...) {}
+                else if (key == "scene_cut_threshold") try { scene_cut_threshold = std::stod(value); }
+                catch (...) {}
+                else if (key == "scene_probe_interval") try { scene_probe_interval = std::stoi(value); }
+                catch (...) {}
+                else if (key == "pan_detection") pan_detection = (value == "true" || value == "1");
+                else if (key == "pan_max_dx") try { pan_max_dx = std::stoi(value); }
+                catch (...) {}
+                else if (key == "pan_max_dy") try { pan_max_dy = std::stoi(value); }
+                catch (...) {}
+                else if (key == "thumbnail_mode") thumbnail_mode = (value == "true" || value == "1");
+                else if (key == "thumbnail_width") try { thumbnail_width = std::stoi(value); }
+                catch (...) {}
+                else if (key == "thumbnail_height") try { thumbnail_height = std::stoi(value); }
+                catch (...) {}
+                else if (key == "thumbnail_quality") try { thumbnail_quality = std::stoi(value); }
+                catch (...) {}
+                else if (key == "frame_history") try { frame_history = std::stoi(value); }
+                catch (...) {}
+                else if (key == "burst_max_frames") try { burst_max_frames = std::stoi(value); }
+                catch (...) {}
+                else if (key == "burst_max_fps") try { burst_max_fps = std::stod(value); }
+                catch (...) {}
+                else if (key == "burst_encode_threads") try { burst_encode_threads = std::stoi(value); }
+                catch (...) {}
+                else if (key == "color_mode") color_mode = value;
+                else if (key == "encoder") encoder = value;
+                else if (key == "image_codec") image_codec = value;
+                else if (key == "lossless_flat_ratio") try { lossless_flat_ratio = std::stod(value); }
+                catch (...) {}
+                else if (key == "mixed_max_colors") try { mixed_max_colors = std::stoi(value); }
+                catch (...) {}
+                else if (key == "frame_dedup") frame_dedup = (value == "true" || value == "1");
+                else if (key == "frame_dedup_cache") try { frame_dedup_cache = std::stoi(value); }
+                catch (...) {}
+                else if (key == "inference_width") try { inference_width = std::stoi(value); }
+                catch (...) {}
+                else if (key == "inference_height") try { inference_height = std::stoi(value); }
+                catch (...) {}
+                else if (key == "source") capture_source = value;
+                else if (key == "synthetic_width") try { synthetic_width = std::stoi(value); }
+                catch (...) {}
+                else if (key == "synthetic_height") try { synthetic_height = std::stoi(value); }
+                catch (...) {}
+                else if (key == "source_fps") try { source_fps = std::stod(value); }
+                catch (...) {}
+                else if (key == "replay_dir") replay_dir = value;
+                else if (key == "replay_cache_mb") try { replay_cache_mb = std::stoi(value); }
+                catch (...) {}
+                else if (key == "x11_display") x11_display = value;
+            }
+            else if (current_section == "Streams") {
+                // 名称 = x,y,宽,高,间隔(毫秒),质量[,编码]
+                CaptureStreamConfig stream;
+                char codec[16] = { 0 };
+                int fields = sscanf(value.c_str(), "%d,%d,%d,%d,%d,%d,%15s",
+                    &stream.rect.x, &stream.rect.y, &stream.rect.width, &stream.rect.height,
+                    &stream.interval_ms, &stream.quality, codec);
+                if (fields == 7) stream.codec = codec;
+                if (fields < 6) {
+                    logWarn_fmt("无效的捕获子流配置: {} = {}", key, value);
+                }
+                else if (!isSupportedStreamCodec(stream.codec)) {
+                    // 不静默改用jpeg：服务端按配置的编码解码子流
+                    logError_fmt("捕获子流 {} 的编码格式不受支持: {}（可用: jpeg），忽略该子流", key, stream.codec);
+                }
+                else {
+                    stream.name = key;
+                    streams.push_back(stream);
+                }
+            }
+            else if (current_section == "Masks") {
+                // 名称 = x,y,宽,高[,RRGGBB]
+                MaskRegion mask;
+                unsigned int color = 0;
+                int fields = sscanf(value.c_str(), "%d,%d,%d,%d,%x",
+                    &mask.rect.x, &mask.rect.y, &mask.rect.width, &mask.rect.height, &color);
+                if (fields >= 4) {
+                    mask.name = key;
+                    if (fields == 5) mask.color = 0xFF000000 | (color & 0xFFFFFF);
+                    masks.push_back(mask);
+                }
+                else {
+                    logWarn_fmt("无效的遮罩配置: {} = {}", key, value);
+                }
             }
             else if (current_section == "Game") {
                 if (key == "window_title") window_title = value;
@@ -137,6 +274,27 @@ void DNFAutoClient::ClientConfig::load_from_file(const std::string& filename) {
                 else if (key == "heartbeat_interval") try { heartbeat_interval = std::stoi(value); }
                 catch (...) {}
             }
+            else if (current_section == "Recorder") {
+                if (key == "enabled") recorder_enabled = (value == "true" || value == "1");
+                else if (key == "seconds") try { recorder_seconds = std::stoi(value); }
+                catch (...) {}
+                else if (key == "max_frames") try { recorder_max_frames = std::stoi(value); }
+                catch (...) {}
+                else if (key == "max_events") try { recorder_max_events = std::stoi(value); }
+                catch (...) {}
+                else if (key == "directory") recorder_directory = value;
+            }
+            else if (current_section == "Performance") {
+                if (key == "memory_pool_size") try { memory_pool_size = std::stoi(value); }
+                catch (...) {}
+                else if (key == "use_multithreading") use_multithreading = (value == "true" || value == "1");
+                else if (key == "capture_threads") try { capture_threads = std::stoi(value); }
+                catch (...) {}
+                else if (key == "jpeg_threads") try { jpeg_threads = std::stoi(value); }
+                catch (...) {}
+                else if (key == "send_queue_size") try { send_queue_size = std::stoi(value); }
+                catch (...) {}
+            }
         }
     }
 
@@ -155,14 +313,130 @@ bool DNFAutoClient::initialize() {
         return false;
     }
 
+    // 初始化帧源
+    if (!initializeFrameSource()) {
+        logError("初始化帧源失败");
+        return false;
+    }
+
     // 初始化屏幕捕获
     if (!screen_capture_.initialize(config_.window_title)) {
         logError("初始化屏幕捕获失败");
         return false;
     }
 
+    // 设置捕获调度（关闭自适应时固定为capture_interval）
+    CaptureSchedulerConfig scheduler_config;
+    scheduler_config.base_interval_ms = static_cast<int>(config_.capture_interval * 1000);
+    scheduler_config.min_interval_ms = config_.adaptive_capture
+        ? static_cast<int>(config_.min_capture_interval * 1000) : scheduler_config.base_interval_ms;
+    scheduler_config.max_interval_ms = config_.adaptive_capture
+        ? static_cast<int>(config_.max_capture_interval * 1000) : scheduler_config.base_interval_ms;
+    scheduler_config.high_motion_ratio = config_.high_motion_ratio;
+    scheduler_config.idle_motion_ratio = config_.idle_motion_ratio;
+    capture_scheduler_.configure(scheduler_config);
+
+    // 设置捕获结果对象池（至少2个：上一帧结果仍被引用时需要另一个对象）
+    // 流水线模式下发送队列和发送线程也各持有结果，相应增加
+    // 飞行记录器保留的帧同样占用结果对象
+    if (config_.recorder_enabled) {
+        flight_recorder_.configure(config_.recorder_seconds, static_cast<size_t>(std::max(config_.recorder_max_frames, 1)),
+            static_cast<size_t>(std::max(config_.recorder_max_events, 1)));
+    }
+
+    int pool_size = std::max(config_.memory_pool_size, 2);
+    if (config_.use_multithreading) {
+        pool_size = std::max(pool_size, config_.send_queue_size + 3);
+    }
+    pool_size += static_cast<int>(flight_recorder_.frameCapacity());
+    screen_capture_.setResultPoolSize(static_cast<size_t>(pool_size));
+
+    // 设置捕获/编码与发送流水线
+    send_queue_.setCapacity(static_cast<size_t>(std::max(config_.send_queue_size, 1)));
+    // 增量区域和连拍共用常驻编码线程池，线程数取两者较大值
+    int burst_threads = config_.burst_encode_threads;
+    if (burst_threads <= 0) {
+        burst_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1);
+    }
+    int encode_threads = std::max(std::max(config_.capture_threads, burst_threads), 1);
+    screen_capture_.setEncodeThreads(encode_threads);
+    screen_capture_.setStripeThreads(std::max(config_.jpeg_threads, 1));
+    logInfo_fmt("发送流水线: {}，发送队列: {}，编码线程: {}，条带编码线程: {}", config_.use_multithreading ? "启用" : "禁用",
+        std::max(config_.send_queue_size, 1), encode_threads, std::max(config_.jpeg_threads, 1));
+
     // 设置屏幕捕获的最小间隔
-    screen_capture_.setMinimumCaptureInterval(static_cast<int>(config_.capture_interval * 500));
+    screen_capture_.setMinimumCaptureInterval(scheduler_config.min_interval_ms / 2);
+
+    // 设置变化检测的瓦片大小
+    screen_capture_.setTileSize(config_.tile_size);
+
+    // 设置感知变化阈值
+    image_change_threshold_ = config_.change_threshold;
+    screen_capture_.setChangeThreshold(image_change_threshold_, config_.change_noise_floor);
+
+    // 设置缩略图模式
+    if (config_.thumbnail_mode) {
+        screen_capture_.setThumbnailMode(true, config_.thumbnail_width, config_.thumbnail_height,
+            config_.thumbnail_quality, config_.frame_history);
+    }
+
+    // 设置静态区域遮罩
+    screen_capture_.setMasks(config_.masks);
+
+    // 设置颜色模式
+    if (config_.color_mode == "gray") {
+        screen_capture_.setLumaOnly(true);
+    }
+    else if (config_.color_mode != "color") {
+        logWarn_fmt("未知的颜色模式: {}，使用彩色", config_.color_mode);
+    }
+
+    // 设置整帧和增量区域的编码方式
+    ImageCodec image_codec = ImageCodec::JPEG;
+    if (!parseImageCodec(config_.image_codec, image_codec)) {
+        logWarn_fmt("未知的图像编码方式: {}，使用JPEG", config_.image_codec);
+    }
+    screen_capture_.setLosslessFlatRatio(config_.lossless_flat_ratio);
+    screen_capture_.setMixedMaxColors(config_.mixed_max_colors);
+    screen_capture_.setImageCodec(image_codec);
+
+    // 设置码率控制（每帧目标字节数为0时使用固定质量）
+    if (config_.target_frame_bytes > 0) {
+        screen_capture_.setFrameBudget(static_cast<size_t>(config_.target_frame_bytes),
+            config_.rate_min_quality, config_.rate_max_quality);
+    }
+
+    // 设置图像编码器（未配置时使用默认编码器）
+    if (!config_.encoder.empty()) {
+        screen_capture_.setEncoder(config_.encoder);
+    }
+    logInfo_fmt("使用图像编码器: {}", screen_capture_.getEncoder());
+
+    // 设置帧去重
+    if (config_.frame_dedup) {
+        screen_capture_.setFrameDedup(static_cast<size_t>(std::max(config_.frame_dedup_cache, 1)));
+    }
+
+    // 设置场景切换检测
+    screen_capture_.setSceneChangeThreshold(config_.scene_cut_threshold);
+
+    // 设置光标遮罩
+    screen_capture_.setCursorMask(config_.cursor_mask, config_.cursor_mask_size, config_.cursor_mask_paint);
+
+    // 设置增量帧编码
+    screen_capture_.setDeltaEncoding(config_.delta_encoding, config_.keyframe_interval);
+
+    // 设置平移检测（依赖增量帧编码）
+    if (config_.delta_encoding && config_.pan_detection) {
+        screen_capture_.setPanDetection(true, config_.pan_max_dx, config_.pan_max_dy);
+    }
+
+    // 设置编码分辨率上限
+    screen_capture_.setOutputResolution(config_.inference_width, config_.inference_height);
+
+    // 设置捕获子流
+    screen_capture_.setStreams(config_.streams);
+    stream_capture_times_.assign(screen_capture_.getStreams().size(), 0);
 
     // 初始化输入模拟器
     if (!input_simulator_.initialize()) {
@@ -178,10 +452,48 @@ bool DNFAutoClient::initialize() {
         this->processServerResponse(message);
     });
 
+    // 记录发送的消息
+    if (flight_recorder_.enabled()) {
+        ws_client_.setSendCallback([this](const std::string& message) {
+            flight_recorder_.recordMessage(true, message);
+        });
+    }
+
     logInfo("初始化完成");
     return true;
 }
 
+bool DNFAutoClient::initializeFrameSource() {
+    if (config_.capture_source == "synthetic") {
+        auto source = std::make_unique<SyntheticFrameSource>();
+        if (!source->initialize(config_.synthetic_width, config_.synthetic_height, config_.source_fps)) {
+            return false;
+        }
+        screen_capture_.setFrameSource(std::move(source));
+    }
+    else if (config_.capture_source == "replay") {
+        auto source = std::make_unique<ReplayFrameSource>();
+        if (!source->initialize(config_.replay_dir, config_.source_fps, config_.replay_cache_mb)) {
+            return false;
+        }
+        screen_capture_.setFrameSource(std::move(source));
+    }
+#ifdef HAVE_X11_CAPTURE
+    else if (config_.capture_source == "x11") {
+        auto source = std::make_unique<X11FrameSource>();
+        if (!source->initialize(config_.window_title, config_.x11_display)) {
+            return false;
+        }
+        screen_capture_.setFrameSource(std::move(source));
+    }
+#endif
+    else if (config_.capture_source != "window") {
+        logWarn_fmt("未知的帧源类型: {}，使用游戏窗口", config_.capture_source);
+    }
+
+    return true;
+}
+
 void DNFAutoClient::initializeStateMachine() {
     // 定义状态转换函数
     state_handlers_[ClientState::DISCONNECTED] = [this]() { handleDisconnectedState(); };
@@ -223,6 +535,9 @@ void DNFAutoClient::stop() {
     // 通知状态监控线程退出
     status_cv_.notify_all();
 
+    // 通知发送线程退出
+    send_queue_.notify();
+
     // 等待线程结束
     if (main_thread_.joinable()) {
         main_thread_.join();
@@ -233,6 +548,9 @@ void DNFAutoClient::stop() {
     if (status_thread_.joinable()) {
         status_thread_.join();
     }
+    if (sender_thread_.joinable()) {
+        sender_thread_.join();
+    }
 
     // 断开WebSocket连接
     ws_client_.disconnect();
@@ -266,6 +584,11 @@ void DNFAutoClient::mainLoop() {
     // 启动状态监控线程
     status_thread_ = std::thread(&DNFAutoClient::statusMonitorThread, this);
 
+    // 启动发送线程（流水线模式）
+    if (config_.use_multithreading) {
+        sender_thread_ = std::thread(&DNFAutoClient::senderThread, this);
+    }
+
     // 主循环 - 状态机
     while (running_) {
         try {
@@ -308,12 +631,19 @@ void DNFAutoClient::changeState(ClientState new_state) {
     logInfo_fmt("状态转换: {} -> {}",
               STATE_NAMES.at(current_state_),
               STATE_NAMES.at(new_state));
+    flight_recorder_.recordEvent(FlightRecorder::EventKind::STATE,
+        STATE_NAMES.at(current_state_) + " -> " + STATE_NAMES.at(new_state));
 
     // 执行状态退出操作
     switch (current_state_) {
         case ClientState::ACTIVE:
-            // 退出活动状态时清空动作队列
+            // 退出活动状态时清空动作队列和待发送的帧
             clearActionQueue();
+            send_queue_.clear();
+            {
+                std::lock_guard<std::mutex> lock(message_mutex_);
+                message_queue_.clear();
+            }
             break;
         default:
             break;
@@ -325,16 +655,23 @@ void DNFAutoClient::changeState(ClientState new_state) {
     // 执行状态进入操作
     switch (current_state_) {
         case ClientState::CONNECTED:
-            // 连接成功时重置错误计数
+            // 连接成功时重置错误计数，新连接的服务端缓存状态未知
+            // 新服务端没有任何参考帧：清除已送达的帧编号，只有关键帧能通过isDecodable，并强制下一帧为关键帧
             consecutive_errors_ = 0;
+            screen_capture_.clearFrameCache();
+            last_sent_keyframe_id_ = -1;
+            last_sent_frame_id_ = -1;
+            screen_capture_.requestKeyframe();
             break;
         case ClientState::ACTIVE:
             // 进入活动状态时重置捕获时间
             last_capture_time_ = 0;
+            next_capture_time_ = 0;
             break;
         case ClientState::ERROR:
-            // 进入错误状态时记录错误
+            // 进入错误状态时记录错误，并写出最近的帧、消息和动作
             logError("客户端进入错误状态");
+            dumpFlightRecorder("error_state");
             break;
         default:
             break;
@@ -400,6 +737,14 @@ void DNFAutoClient::handleActiveState() {
         return;
     }
 
+    // 发送线程连续失败
+    if (send_failures_ > 3) {
+        logError("连续发送失败，断开连接");
+        send_failures_ = 0;
+        changeState(ClientState::DISCONNECTED);
+        return;
+    }
+
     // 检查游戏窗口是否有效
     if (!screen_capture_.isWindowValid()) {
         logWarn("游戏窗口无效，尝试重新初始化");
@@ -419,51 +764,307 @@ void DNFAutoClient::handleActiveState() {
     if (ms_since_heartbeat >= config_.heartbeat_interval * 1000) {
         // 发送心跳
         updateGameState();
-        ws_client_.sendHeartbeat(game_state_);
+        PendingMessage heartbeat;
+        heartbeat.game_state = game_state_;
+        postMessage(std::move(heartbeat));
         last_heartbeat_time_ = now.time_since_epoch().count();
     }
 
-    // 检查是否是时候捕获屏幕
+    // 响应全分辨率帧请求
+    processFullFrameRequests();
+
+    // 连拍期间暂停常规捕获，结束后从当前时间重新开始常规节奏
+    if (processBurstRequest()) {
+        next_capture_time_ = (std::chrono::steady_clock::now() + std::chrono::milliseconds(capture_scheduler_.intervalMs()))
+            .time_since_epoch().count();
+        return;
+    }
+
+    // 子流按各自的间隔独立捕获
+    captureDueStreams(now);
+
+    // 检查是否是时候捕获屏幕（间隔由自适应调度器决定）
+    // 启用探测时在等待期间定期探测场景切换，发现时立即捕获（最小化时不探测）
+    if (now.time_since_epoch().count() < next_capture_time_) {
+        if (config_.scene_cut_threshold <= 0 || config_.scene_probe_interval <= 0 ||
+            now.time_since_epoch().count() < next_scene_probe_time_ || screen_capture_.isWindowMinimized()) {
+            return;
+        }
+
+        next_scene_probe_time_ = (now + std::chrono::milliseconds(config_.scene_probe_interval))
+            .time_since_epoch().count();
+        if (!screen_capture_.probeSceneChange()) {
+            return;
+        }
+    }
+
     auto ms_since_capture = std::chrono::duration_cast<std::chrono::milliseconds>(
         now - std::chrono::steady_clock::time_point(
             std::chrono::steady_clock::duration(last_capture_time_))).count();
 
-    if (ms_since_capture >= config_.capture_interval * 1000) {
-        // 捕获屏幕
-        auto capture_result = screen_capture_.captureScreen(config_.image_quality);
-        if (!capture_result) {
-            logError("屏幕捕获失败");
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // 窗口最小化时无法获得有效图像，退避到最长间隔
+    if (screen_capture_.isWindowMinimized()) {
+        capture_scheduler_.onMinimized();
+        next_capture_time_ = (now + std::chrono::milliseconds(capture_scheduler_.intervalMs()))
+            .time_since_epoch().count();
+        return;
+    }
+
+    // 捕获屏幕（光标位置用于从变化检测中排除光标）
+    screen_capture_.setCursorPosition(input_simulator_.getMousePosition());
+    CaptureChange change;
+    auto capture_result = screen_capture_.captureScreen(config_.image_quality, change);
+    if (!capture_result) {
+        logError("屏幕捕获失败");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return;
+    }
+
+    // 按相对上一帧的运动量安排下一次捕获
+    capture_scheduler_.onCapture(change.motion_ratio, change.changed);
+    next_capture_time_ = (now + std::chrono::milliseconds(capture_scheduler_.intervalMs()))
+        .time_since_epoch().count();
+
+    // 检查图像是否有明显变化
+    bool significant_change = change.changed;
+
+    // 如果图像有显著变化或上次发送已经过去较长时间，则发送图像
+    if (significant_change || ms_since_capture >= capture_scheduler_.intervalMs() * 3) {
+        // 更新游戏状态
+        updateGameState();
+
+        // 流水线模式：交给发送线程，主线程继续捕获下一帧
+        // 队列满时丢弃最旧的帧，服务端总是尽快收到最新画面
+        if (config_.use_multithreading) {
+            PendingCapture dropped;
+            if (send_queue_.push({ capture_result, game_state_ }, &dropped)) {
+                int64_t dropped_id = dropped.result ? dropped.result->frame_id : 0;
+                logDebug_fmt("发送队列已满，丢弃帧: {}，累计丢弃: {}", dropped_id, send_queue_.droppedCount());
+                flight_recorder_.recordEvent(FlightRecorder::EventKind::DROP, std::to_string(dropped_id));
+            }
+            last_capture_time_ = now.time_since_epoch().count();
             return;
         }
 
-        // 检查图像是否有明显变化
-        bool significant_change = capture_result->changed;
+        // 参考帧未送达（如重新连接后）的增量帧/平移帧在服务端无法还原：跳过并请求关键帧
+        if (!isDecodable(*capture_result)) {
+            logDebug_fmt("参考帧未送达，跳过帧: {}", capture_result->frame_id);
+            flight_recorder_.recordEvent(FlightRecorder::EventKind::DROP, std::to_string(capture_result->frame_id));
+            screen_capture_.requestKeyframe();
+            return;
+        }
 
-        // 如果图像有显著变化或上次发送已经过去较长时间，则发送图像
-        if (significant_change || ms_since_capture >= config_.capture_interval * 3000) {
-            // 更新游戏状态
-            updateGameState();
+        // 发送图像到服务器：关键帧发送整帧，增量帧只发送变化区域，并附带关注区域
+        bool sent = sendCaptureResult(*capture_result, game_state_);
 
-            // 发送图像到服务器
-            if (!ws_client_.sendImage(capture_result->jpeg_data, game_state_, capture_result->window_rect)) {
-                logError("发送图像失败");
-                consecutive_errors_++;
+        if (!sent) {
+            logError("发送图像失败");
+            consecutive_errors_++;
 
-                if (consecutive_errors_ > 3) {
-                    logError("连续发送失败，断开连接");
-                    changeState(ClientState::DISCONNECTED);
-                    return;
-                }
-            } else {
-                // 发送成功，重置错误计数
-                consecutive_errors_ = 0;
+            // 服务端可能缺少参考帧，下一帧发送关键帧
+            screen_capture_.requestKeyframe();
+
+            if (consecutive_errors_ > 3) {
+                logError("连续发送失败，断开连接");
+                changeState(ClientState::DISCONNECTED);
+                return;
             }
+        } else {
+            // 发送成功，重置错误计数；飞行记录器保留结果的引用
+            consecutive_errors_ = 0;
+            onCaptureDelivered(*capture_result);
+            flight_recorder_.recordFrame(capture_result);
+        }
 
-            // 更新最后捕获时间
-            last_capture_time_ = now.time_since_epoch().count();
+        // 更新最后发送时间
+        last_capture_time_ = now.time_since_epoch().count();
+    }
+}
+
+void DNFAutoClient::captureDueStreams(std::chrono::steady_clock::time_point now) {
+    const auto& streams = screen_capture_.getStreams();
+    if (streams.empty()) {
+        return;
+    }
+
+    // 收集到期的子流
+    std::vector<size_t>& due = due_streams_;
+    due.clear();
+    for (size_t i = 0; i < streams.size(); i++) {
+        auto ms_since_stream = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - std::chrono::steady_clock::time_point(
+                std::chrono::steady_clock::duration(stream_capture_times_[i]))).count();
+        if (ms_since_stream >= streams[i].interval_ms) {
+            due.push_back(i);
+            stream_capture_times_[i] = now.time_since_epoch().count();
         }
     }
+
+    if (due.empty()) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<StreamCaptureResult>>& results = stream_results_;
+    screen_capture_.captureStreams(due, results);
+    RECT window_rect = screen_capture_.getWindowRect();
+    for (const auto& result : results) {
+        // 无变化的子流不发送，服务端保留上一次的图像
+        if (!result || !result->changed) {
+            continue;
+        }
+
+        PendingMessage message;
+        message.kind = PendingMessage::Kind::STREAM;
+        message.stream = result;
+        message.window_rect = window_rect;
+        postMessage(std::move(message));
+    }
+
+    // 释放结果的引用，发送完成后归还对象池
+    results.clear();
+}
+
+bool DNFAutoClient::sendCaptureResult(const CaptureResult& result, const GameState& state) {
+    int request_id = 0;
+    if (!ws_client_.sendCapture(result, state, &request_id)) {
+        return false;
+    }
+
+    // 记录请求ID对应的帧，用于服务端按请求ID拉取全分辨率帧
+    if (result.thumbnail) {
+        std::lock_guard<std::mutex> lock(full_frame_mutex_);
+        sent_frame_ids_.emplace_back(request_id, result.frame_id);
+        while (sent_frame_ids_.size() > static_cast<size_t>(std::max(config_.frame_history, 1)) * 2) {
+            sent_frame_ids_.pop_front();
+        }
+    }
+    return true;
+}
+
+bool DNFAutoClient::isDecodable(const CaptureResult& result) const {
+    // 无变化时定期重发的帧（与上次送达的帧编号相同）照常发送
+    if (result.is_keyframe || result.roi_only || result.frame_id == last_sent_frame_id_) {
+        return true;
+    }
+    return result.is_pan ? result.pan_reference_id == last_sent_frame_id_
+                         : result.keyframe_id == last_sent_keyframe_id_;
+}
+
+void DNFAutoClient::onCaptureDelivered(const CaptureResult& result) {
+    if (!result.roi_only) {
+        last_sent_frame_id_ = result.frame_id;
+    }
+    if (result.is_keyframe || result.is_pan) {
+        last_sent_keyframe_id_ = result.keyframe_id;
+    }
+}
+
+void DNFAutoClient::senderThread() {
+    logInfo("发送线程启动");
+
+    PendingCapture item;
+    while (running_) {
+        // 先发送排队的心跳、子流等消息，postMessage会唤醒下面的等待
+        sendPendingMessages();
+
+        if (!send_queue_.pop(item, std::chrono::milliseconds(100))) {
+            continue;
+        }
+
+        const CaptureResult& result = *item.result;
+        if (!ws_client_.isConnected()) {
+            item = PendingCapture();
+            continue;
+        }
+
+        // 队列丢帧或重新连接后，参考帧未送达的增量帧/平移帧在服务端无法还原：跳过并请求关键帧
+        if (!isDecodable(result)) {
+            logDebug_fmt("参考帧已丢弃，跳过帧: {}", result.frame_id);
+            flight_recorder_.recordEvent(FlightRecorder::EventKind::DROP, std::to_string(result.frame_id));
+            screen_capture_.requestKeyframe();
+            item = PendingCapture();
+            continue;
+        }
+
+        if (sendCaptureResult(result, item.game_state)) {
+            send_failures_ = 0;
+            flight_recorder_.recordFrame(item.result);
+            onCaptureDelivered(result);
+
+            auto age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now() - result.timestamp).count();
+            logDebug_fmt("已发送帧: {}，捕获到发送完成: {} ms", result.frame_id, age_ms);
+        }
+        else {
+            logError("发送图像失败");
+            send_failures_++;
+
+            // 服务端可能缺少参考帧，下一帧发送关键帧
+            screen_capture_.requestKeyframe();
+        }
+
+        // 释放结果，归还对象池
+        item = PendingCapture();
+    }
+
+    logInfo("发送线程已结束");
+}
+
+void DNFAutoClient::postMessage(PendingMessage message) {
+    // 非流水线模式没有发送线程，在当前线程直接发送
+    if (!config_.use_multithreading) {
+        sendMessage(message);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(message_mutex_);
+        if (message_queue_.size() >= MAX_PENDING_MESSAGES) {
+            logWarn_fmt("待发送消息积压 {} 条，丢弃最旧的消息", message_queue_.size());
+            message_queue_.pop_front();
+        }
+        message_queue_.push_back(std::move(message));
+    }
+    send_queue_.notify();
+}
+
+void DNFAutoClient::sendPendingMessages() {
+    while (running_) {
+        PendingMessage message;
+        {
+            std::lock_guard<std::mutex> lock(message_mutex_);
+            if (message_queue_.empty()) {
+                return;
+            }
+            message = std::move(message_queue_.front());
+            message_queue_.pop_front();
+        }
+        sendMessage(message);
+    }
+}
+
+void DNFAutoClient::sendMessage(const PendingMessage& message) {
+    switch (message.kind) {
+        case PendingMessage::Kind::HEARTBEAT:
+            ws_client_.sendHeartbeat(message.game_state);
+            break;
+        case PendingMessage::Kind::STREAM:
+            if (!ws_client_.sendStream(*message.stream, message.window_rect)) {
+                logWarn_fmt("发送子流失败: {}", message.stream->stream);
+            }
+            break;
+        case PendingMessage::Kind::FULL_FRAME:
+            if (!ws_client_.sendFullFrame(message.request_id, message.frame_id,
+                                          message.found ? &message.patch : nullptr)) {
+                logWarn_fmt("响应全分辨率帧请求失败，请求ID: {}", message.request_id);
+            }
+            break;
+        case PendingMessage::Kind::BURST:
+            if (!ws_client_.sendBurst(*message.burst, message.request_id)) {
+                logWarn_fmt("发送连拍失败，请求ID: {}", message.request_id);
+            }
+            break;
+    }
 }
 
 void DNFAutoClient::handlePausedState() {
@@ -476,7 +1077,9 @@ void DNFAutoClient::handlePausedState() {
     if (ms_since_heartbeat >= config_.heartbeat_interval * 1000) {
         // 发送心跳
         updateGameState();
-        ws_client_.sendHeartbeat(game_state_);
+        PendingMessage heartbeat;
+        heartbeat.game_state = game_state_;
+        postMessage(std::move(heartbeat));
         last_heartbeat_time_ = now.time_since_epoch().count();
     }
 
@@ -609,6 +1212,8 @@ void DNFAutoClient::clearActionQueue() {
 }
 
 void DNFAutoClient::processServerResponse(const std::string& response) {
+    flight_recorder_.recordMessage(false, response);
+
     try {
         // 使用nlohmann-json解析
         json data = json::parse(response);
@@ -625,6 +1230,42 @@ void DNFAutoClient::processServerResponse(const std::string& response) {
         else if (message_type == "error") {
             handleErrorResponse(data);
         }
+        else if (message_type == "request_keyframe") {
+            handleKeyframeRequest(data);
+        }
+        else if (message_type == "set_roi") {
+            handleRoiRequest(data);
+        }
+        else if (message_type == "set_inference_resolution") {
+            handleInferenceResolution(data);
+        }
+        else if (message_type == "set_masks") {
+            handleMaskRequest(data);
+        }
+        else if (message_type == "request_full_frame") {
+            handleFullFrameRequest(data);
+        }
+        else if (message_type == "burst") {
+            handleBurstRequest(data);
+        }
+        else if (message_type == "set_color_mode") {
+            handleColorMode(data);
+        }
+        else if (message_type == "set_image_codec") {
+            handleImageCodec(data);
+        }
+        else if (message_type == "set_frame_budget") {
+            handleFrameBudget(data);
+        }
+        else if (message_type == "dump_recorder") {
+            handleRecorderDump(data);
+        }
+        else if (message_type == "cache_ack") {
+            handleCacheAck(data);
+        }
+        else if (message_type == "cache_miss") {
+            handleCacheMiss(data);
+        }
         else {
             logWarn_fmt("收到未知类型的消息: {}", message_type);
         }
@@ -737,6 +1378,234 @@ void DNFAutoClient::handleErrorResponse(const json& data) {
     }
 }
 
+void DNFAutoClient::handleKeyframeRequest(const json& data) {
+    // 服务端丢失参考帧或需要重新同步时请求关键帧
+    logInfo_fmt("服务端请求关键帧，原因: {}", data.value("reason", "未说明"));
+    screen_capture_.requestKeyframe();
+}
+
+void DNFAutoClient::handleColorMode(const json& data) {
+    // 服务端模型只使用灰度输入时切换为亮度模式，减少编码时间和传输量
+    std::string mode = data.value("mode", "");
+    if (mode != "color" && mode != "gray") {
+        logWarn_fmt("无效的颜色模式: {}", mode);
+        return;
+    }
+
+    logInfo_fmt("服务端颜色模式: {}", mode);
+    screen_capture_.setLumaOnly(mode == "gray");
+}
+
+void DNFAutoClient::handleImageCodec(const json& data) {
+    // 服务端需要读取界面文字时切换为无损编码
+    ImageCodec codec = ImageCodec::JPEG;
+    std::string name = data.value("codec", "");
+    if (!parseImageCodec(name, codec)) {
+        logWarn_fmt("无效的图像编码方式: {}", name);
+        return;
+    }
+
+    logInfo_fmt("服务端图像编码方式: {}", name);
+    screen_capture_.setImageCodec(codec);
+}
+
+void DNFAutoClient::handleFrameBudget(const json& data) {
+    // 服务端按可用带宽设置每帧目标字节数，0恢复固定质量
+    int bytes = data.value("bytes", 0);
+    if (bytes < 0) {
+        logWarn_fmt("无效的每帧目标字节数: {}", bytes);
+        return;
+    }
+
+    screen_capture_.setFrameBudget(static_cast<size_t>(bytes),
+        data.value("min_quality", config_.rate_min_quality), data.value("max_quality", config_.rate_max_quality));
+}
+
+void DNFAutoClient::handleRecorderDump(const json& data) {
+    // 服务端发现异常时按需写出飞行记录
+    dumpFlightRecorder(data.value("reason", "server_request"));
+}
+
+void DNFAutoClient::handleCacheAck(const json& data) {
+    // 服务端已缓存关键帧，之后相同内容的帧只发送引用
+    FrameDigest digest;
+    if (!FrameDigest::fromHex(data.value("hash", ""), digest)) {
+        logWarn("无效的缓存确认消息");
+        return;
+    }
+    screen_capture_.confirmCachedFrame(digest);
+}
+
+void DNFAutoClient::handleCacheMiss(const json& data) {
+    // 服务端找不到引用的帧，回退为发送完整关键帧
+    FrameDigest digest;
+    if (!FrameDigest::fromHex(data.value("hash", ""), digest)) {
+        logWarn("无效的缓存未命中消息，请求关键帧");
+        screen_capture_.requestKeyframe();
+        return;
+    }
+    screen_capture_.onCacheMiss(digest);
+}
+
+void DNFAutoClient::handleRoiRequest(const json& data) {
+    // 服务端指定需要关注的区域（如小地图、血条），空列表表示取消
+    RoiSettings settings;
+    settings.include_full = data.value("include_full", true);
+    settings.full_quality = data.value("full_quality", 0);
+
+    if (data.contains("regions") && data["regions"].is_array()) {
+        for (const auto& region_json : data["regions"]) {
+            RoiRegion region;
+            region.name = region_json.value("name", "");
+            region.rect.x = region_json.value("x", 0);
+            region.rect.y = region_json.value("y", 0);
+            region.rect.width = region_json.value("w", 0);
+            region.rect.height = region_json.value("h", 0);
+            region.quality = std::min(std::max(region_json.value("quality", config_.image_quality), 1), 100);
+            region.scale = std::min(std::max(region_json.value("scale", 1.0), 0.05), 1.0);
+
+            if (region.rect.empty()) {
+                logWarn_fmt("忽略无效的关注区域: {}", region.name);
+                continue;
+            }
+            settings.regions.push_back(region);
+        }
+    }
+
+    screen_capture_.setRoiSettings(settings);
+}
+
+void DNFAutoClient::handleInferenceResolution(const json& data) {
+    // 服务端模型的输入分辨率，客户端直接缩小到该尺寸再编码
+    int width = data.value("width", 0);
+    int height = data.value("height", 0);
+    if (width < 0 || height < 0 || width > 7680 || height > 4320) {
+        logWarn_fmt("无效的推理分辨率: {}x{}", width, height);
+        return;
+    }
+
+    logInfo_fmt("服务端推理分辨率: {}x{}", width, height);
+    screen_capture_.setOutputResolution(width, height);
+}
+
+void DNFAutoClient::handleMaskRequest(const json& data) {
+    // 服务端下发的遮罩与配置文件中的遮罩合并，空列表表示只保留配置文件中的遮罩
+    std::vector<MaskRegion> masks = config_.masks;
+
+    if (data.contains("masks") && data["masks"].is_array()) {
+        for (const auto& mask_json : data["masks"]) {
+            MaskRegion mask;
+            mask.name = mask_json.value("name", "");
+            mask.rect.x = mask_json.value("x", 0);
+            mask.rect.y = mask_json.value("y", 0);
+            mask.rect.width = mask_json.value("w", 0);
+            mask.rect.height = mask_json.value("h", 0);
+            mask.color = 0xFF000000 | (mask_json.value("color", 0u) & 0xFFFFFF);
+            masks.push_back(mask);
+        }
+    }
+
+    screen_capture_.setMasks(masks);
+}
+
+void DNFAutoClient::handleFullFrameRequest(const json& data) {
+    // 服务端根据缩略图判断需要细节时拉取全分辨率帧，编码在主线程中进行
+    FullFrameRequest request;
+    request.request_id = data.value("request_id", 0);
+    request.frame_id = data.value("frame_id", static_cast<int64_t>(0));
+    request.quality = std::min(std::max(data.value("quality", 90), 1), 100);
+    if (data.contains("crop") && data["crop"].is_object()) {
+        const auto& crop = data["crop"];
+        request.crop.x = crop.value("x", 0);
+        request.crop.y = crop.value("y", 0);
+        request.crop.width = crop.value("w", 0);
+        request.crop.height = crop.value("h", 0);
+    }
+
+    std::lock_guard<std::mutex> lock(full_frame_mutex_);
+    full_frame_requests_.push(request);
+}
+
+void DNFAutoClient::processFullFrameRequests() {
+    std::queue<FullFrameRequest> requests;
+    {
+        std::lock_guard<std::mutex> lock(full_frame_mutex_);
+        std::swap(requests, full_frame_requests_);
+    }
+
+    while (!requests.empty()) {
+        FullFrameRequest request = requests.front();
+        requests.pop();
+
+        // 按请求ID查找帧编号
+        int64_t frame_id = request.frame_id;
+        if (frame_id <= 0) {
+            std::lock_guard<std::mutex> lock(full_frame_mutex_);
+            for (const auto& sent : sent_frame_ids_) {
+                if (sent.first == request.request_id) {
+                    frame_id = sent.second;
+                    break;
+                }
+            }
+        }
+
+        PendingMessage message;
+        message.kind = PendingMessage::Kind::FULL_FRAME;
+        message.request_id = request.request_id;
+        message.frame_id = frame_id;
+        message.found = frame_id > 0 &&
+            screen_capture_.encodeHistoryFrame(frame_id, request.crop, request.quality, message.patch);
+        postMessage(std::move(message));
+    }
+}
+
+void DNFAutoClient::handleBurstRequest(const json& data) {
+    // 服务端需要短时间内的连续帧（闪避、连招时机等），按最高帧率和最大帧数限制
+    BurstSettings settings;
+    int max_frames = std::max(config_.burst_max_frames, 1);
+    int min_interval_ms = config_.burst_max_fps > 0 ? static_cast<int>(std::ceil(1000.0 / config_.burst_max_fps)) : 0;
+    settings.count = std::min(std::max(data.value("count", 5), 1), max_frames);
+    settings.interval_ms = data.contains("fps") && data["fps"].is_number() && data["fps"].get<double>() > 0
+        ? static_cast<int>(1000.0 / data["fps"].get<double>())
+        : data.value("interval_ms", 33);
+    settings.interval_ms = std::max(settings.interval_ms, min_interval_ms);
+    settings.quality = std::min(std::max(data.value("quality", config_.image_quality), 1), 100);
+
+    logInfo_fmt("服务端请求连拍: {} 帧，间隔: {} 毫秒，质量: {}", settings.count, settings.interval_ms, settings.quality);
+
+    std::lock_guard<std::mutex> lock(burst_mutex_);
+    pending_burst_ = settings;
+    pending_burst_request_id_ = data.value("request_id", 0);
+    burst_pending_ = true;
+}
+
+bool DNFAutoClient::processBurstRequest() {
+    BurstSettings settings;
+    int request_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(burst_mutex_);
+        if (!burst_pending_) {
+            return false;
+        }
+        settings = pending_burst_;
+        request_id = pending_burst_request_id_;
+        burst_pending_ = false;
+    }
+
+    auto result = std::make_shared<BurstResult>();
+    if (!screen_capture_.captureBurst(settings, *result)) {
+        logError("连拍失败");
+        return true;
+    }
+
+    PendingMessage message;
+    message.kind = PendingMessage::Kind::BURST;
+    message.request_id = request_id;
+    message.burst = std::move(result);
+    postMessage(std::move(message));
+    return true;
+}
+
 void DNFAutoClient::executeAction(const Action& action) {
     try {
         // 执行动作前等待指定的延迟
@@ -746,6 +1615,11 @@ void DNFAutoClient::executeAction(const Action& action) {
         }
 
         logInfo_fmt("执行动作: {}", action.description.empty() ? action.type : action.description);
+        if (flight_recorder_.enabled()) {
+            flight_recorder_.recordEvent(FlightRecorder::EventKind::ACTION,
+                action.type + (action.key.empty() ? "" : " " + action.key) +
+                (action.description.empty() ? "" : " " + action.description));
+        }
 
         if (action.type == "move_to" && action.position.size() >= 2) {
             // 移动到指定位置
@@ -895,4 +1769,25 @@ std::string DNFAutoClient::getStateString() const {
         return it->second;
     }
     return "未知";
+}
+
+bool DNFAutoClient::dumpFlightRecorder(const std::string& reason) {
+    if (!flight_recorder_.enabled()) {
+        return false;
+    }
+
+    // 目录不存在时创建（默认logs）
+    std::error_code error;
+    std::filesystem::create_directories(config_.recorder_directory, error);
+    if (error) {
+        logError_fmt("无法创建飞行记录目录: {}，{}", config_.recorder_directory, error.message());
+        return false;
+    }
+
+    // 文件名包含毫秒时间戳和序号，同一秒内的多次写入不会互相覆盖
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string path = config_.recorder_directory + "/flight_" + std::to_string(now_ms) + "_" +
+        std::to_string(++recorder_dump_count_) + ".rec";
+    return flight_recorder_.dump(path, reason);
 }
\ No newline at end of file
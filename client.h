@@ -9,12 +9,16 @@
 #include <atomic>
 #include <unordered_map>
 #include <map>
+#include <deque>
 #include <functional>
 #include <random>
 #include <nlohmann/json.hpp>
 #include "screen_capture.h"
+#include "capture_scheduler.h"
 #include "input_simulator.h"
 #include "websocket_client.h"
+#include "frame_queue.h"
+#include "flight_recorder.h"
 
 // 客户端状态枚举 - 注意ERROR被重命名为ERROR_STATE以避免与Windows宏冲突
 enum class ClientState {
@@ -54,21 +58,84 @@ public:
     ClientState getState() const;
     std::string getStateString() const;
 
+    // 将飞行记录（最近的帧、消息和动作）写入文件，返回是否成功
+    bool dumpFlightRecorder(const std::string& reason);
+
 private:
     // 配置结构体
     struct ClientConfig {
         std::string server_url = "ws://localhost:8080";
         bool verify_ssl = false;
         double capture_interval = 0.5;  // 捕获间隔（秒）
+        bool adaptive_capture = true;   // 根据场景运动量自适应调整捕获间隔
+        double min_capture_interval = 0.1; // 自适应捕获的最短间隔（秒）
+        double max_capture_interval = 5.0; // 自适应捕获的最长间隔（秒）
+        double high_motion_ratio = 0.15; // 脏瓦片比例达到该值时使用最短间隔
+        double idle_motion_ratio = 0.01; // 脏瓦片比例低于该值视为静止
         int image_quality = 80;         // 图像质量 (1-100)
+        int target_frame_bytes = 0;     // 每帧目标字节数（0表示使用固定质量）
+        int rate_min_quality = 30;      // 码率控制的最低质量
+        int rate_max_quality = 90;      // 码率控制的最高质量
+        int tile_size = 32;             // 变化检测瓦片大小（像素）
+        int change_threshold = 5;       // 感知变化阈值（按块数归一化的块亮度距离，0表示禁用）
+        int change_noise_floor = 6;     // 单块忽略的亮度差
+        bool cursor_mask = true;        // 变化检测忽略模拟光标周围区域
+        int cursor_mask_size = 32;      // 光标遮罩边长（像素）
+        bool cursor_mask_paint = false; // 是否在发送的图像中覆盖光标
+        bool delta_encoding = false;    // 是否发送增量帧
+        int keyframe_interval = 30;     // 关键帧间最大增量帧数
+        double scene_cut_threshold = 0.5; // 场景切换的直方图距离阈值（0表示禁用）
+        int scene_probe_interval = 0;   // 两次捕获之间探测场景切换的间隔（毫秒，0表示不探测，只在捕获时检测）
+        bool pan_detection = false;     // 检测横版场景的整体平移
+        int pan_max_dx = 64;            // 平移检测的水平搜索范围（像素）
+        int pan_max_dy = 16;            // 平移检测的垂直搜索范围（像素）
+        bool thumbnail_mode = false;    // 每帧只发送缩略图，服务端按需拉取全分辨率帧
+        int thumbnail_width = 480;      // 缩略图尺寸上限
+        int thumbnail_height = 270;
+        int thumbnail_quality = 60;     // 缩略图JPEG质量
+        int frame_history = 8;          // 保存的全分辨率帧数
+        int burst_max_frames = 30;      // 单次连拍的最大帧数
+        double burst_max_fps = 60.0;    // 连拍的最高帧率（限制CPU占用）
+        int burst_encode_threads = 0;   // 连拍并行编码线程数（0表示按CPU核数，与capture_threads共用线程池）
+        std::string color_mode = "color"; // 图像颜色模式: color / gray（只编码亮度）
+        std::string encoder;            // 图像编码器: turbojpeg / gdiplus（空表示默认）
+        std::string image_codec = "jpeg"; // 整帧和增量区域的编码: jpeg / lossless / auto（界面画面无损） / mixed（界面块无损）
+        double lossless_flat_ratio = 0.7; // auto模式下判定为界面画面的平坦像素比例
+        int mixed_max_colors = 32;      // mixed模式下判定为界面块的最大颜色数
+        bool frame_dedup = false;       // 重复出现的关键帧只发送内容摘要引用
+        int frame_dedup_cache = 128;    // 记录的服务端已缓存帧数
+        int inference_width = 0;        // 编码分辨率上限（0表示原始分辨率，可由服务端覆盖）
+        int inference_height = 0;
+        std::string capture_source = "window"; // 帧源: window / synthetic / replay / x11
+        int synthetic_width = 1920;     // 合成帧宽度
+        int synthetic_height = 1080;    // 合成帧高度
+        double source_fps = 30.0;       // 合成/回放帧率（<=0不限速）
+        std::string replay_dir;         // 回放帧目录
+        int replay_cache_mb = 512;      // 回放帧预加载的内存上限（MB），超出时逐帧加载
+        std::string x11_display;        // X11帧源的显示（为空时使用DISPLAY环境变量）
+        std::vector<CaptureStreamConfig> streams; // 捕获子流
+        std::vector<MaskRegion> masks;  // 静态区域遮罩
         std::string window_title = "地下城与勇士";
         int max_retries = 5;            // 最大重试次数
         int retry_delay = 5;            // 重试延迟（秒）
         int heartbeat_interval = 30;    // 心跳间隔（秒）
+        int memory_pool_size = 10;      // 捕获结果对象池大小（编码缓冲区随结果循环复用）
+        bool use_multithreading = true; // 捕获/编码与发送分线程流水线执行
+        int capture_threads = 1;        // 增量帧并行编码线程数
+        int jpeg_threads = 1;           // 大图像按水平条带并行编码的线程数（1表示不分条带）
+        int send_queue_size = 2;        // 发送队列长度（满时丢弃最旧的帧）
+        bool recorder_enabled = true;   // 飞行记录器：进入错误状态时写出最近的帧、消息和动作
+        int recorder_seconds = 10;      // 记录的时间窗口（秒）
+        int recorder_max_frames = 60;   // 保留的最大帧数（占用对象池中的捕获结果）
+        int recorder_max_events = 1000; // 保留的最大消息/动作数
+        std::string recorder_directory = "logs"; // 记录文件目录
 
         void load_from_file(const std::string& filename);
     };
 
+    // 根据配置创建帧源
+    bool initializeFrameSource();
+
     // 状态机相关
     void initializeStateMachine();
     void changeState(ClientState new_state);
@@ -85,17 +152,54 @@ private:
     void mainLoop();
     void actionThread();
     void statusMonitorThread();
+    void senderThread();
 
     // 消息处理
     void processServerResponse(const std::string& response);
     void handleActionResponse(const nlohmann::json& data);
     void handleHeartbeatResponse(const nlohmann::json& data);
     void handleErrorResponse(const nlohmann::json& data);
+    void handleKeyframeRequest(const nlohmann::json& data);
+    void handleRoiRequest(const nlohmann::json& data);
+    void handleInferenceResolution(const nlohmann::json& data);
+    void handleMaskRequest(const nlohmann::json& data);
+    void handleFullFrameRequest(const nlohmann::json& data);
+    void handleBurstRequest(const nlohmann::json& data);
+    void handleColorMode(const nlohmann::json& data);
+    void handleImageCodec(const nlohmann::json& data);
+    void handleFrameBudget(const nlohmann::json& data);
+    void handleRecorderDump(const nlohmann::json& data);
+    void handleCacheAck(const nlohmann::json& data);
+    void handleCacheMiss(const nlohmann::json& data);
+
+    // 发送捕获结果并记录请求ID对应的帧编号（主线程或发送线程调用）
+    bool sendCaptureResult(const CaptureResult& result, const GameState& state);
+
+    // 服务端能否还原该帧：增量帧/平移帧参考的帧必须已在当前连接上送达
+    bool isDecodable(const CaptureResult& result) const;
+
+    // 记录已送达的帧，作为后续增量帧/平移帧的参考
+    void onCaptureDelivered(const CaptureResult& result);
+
+    // 心跳、子流、全分辨率帧和连拍消息：流水线模式下交给发送线程，否则直接发送
+    struct PendingMessage;
+    void postMessage(PendingMessage message);
+    void sendMessage(const PendingMessage& message);
+    void sendPendingMessages();
+
+    // 处理服务端排队的全分辨率帧请求（在主线程中编码）
+    void processFullFrameRequests();
+
+    // 执行服务端请求的连拍（在主线程中捕获和编码），返回是否执行了连拍
+    bool processBurstRequest();
 
     // 动作执行
     void executeAction(const Action& action);
     void clearActionQueue();
 
+    // 捕获并发送到期的子流
+    void captureDueStreams(std::chrono::steady_clock::time_point now);
+
     // 状态更新
     void updateGameState();
 
@@ -104,20 +208,67 @@ private:
 
     // 组件
     ScreenCapture screen_capture_;
+    AdaptiveCaptureScheduler capture_scheduler_;
     InputSimulator input_simulator_;
     WebSocketClient ws_client_;
     GameState game_state_;
+    FlightRecorder flight_recorder_;
+    std::atomic<int> recorder_dump_count_; // 已写入的飞行记录文件数（用于文件名，避免同一毫秒内重名）
 
     // 线程
     std::thread main_thread_;
     std::thread action_thread_;
     std::thread status_thread_;
+    std::thread sender_thread_;
     std::atomic<bool> running_;
 
+    // 捕获/编码与发送流水线：主线程编码后入队，发送线程序列化并发送
+    struct PendingCapture {
+        std::shared_ptr<CaptureResult> result;
+        GameState game_state;           // 入队时的游戏状态
+    };
+    FrameQueue<PendingCapture> send_queue_;
+
+    // 主帧之外的消息：主线程入队后唤醒发送线程，按入队顺序发送，不与主帧一起丢弃
+    struct PendingMessage {
+        enum class Kind { HEARTBEAT, STREAM, FULL_FRAME, BURST };
+        Kind kind = Kind::HEARTBEAT;
+        GameState game_state;                        // 心跳：入队时的游戏状态
+        std::shared_ptr<StreamCaptureResult> stream; // 子流结果
+        RECT window_rect = { 0, 0, 0, 0 };           // 子流：窗口矩形
+        int request_id = 0;                          // 全分辨率帧/连拍：服务端请求ID
+        int64_t frame_id = 0;                        // 全分辨率帧：帧编号
+        bool found = false;                          // 全分辨率帧：是否仍在历史中
+        EncodedPatch patch;                          // 全分辨率帧图像
+        std::shared_ptr<BurstResult> burst;          // 连拍结果
+    };
+    std::deque<PendingMessage> message_queue_;
+    std::mutex message_mutex_;
+    std::atomic<int> send_failures_;    // 发送线程的连续失败次数
+    std::atomic<int> last_sent_keyframe_id_;   // 当前连接已送达的关键帧编号（-1表示尚未送达关键帧）
+    std::atomic<int64_t> last_sent_frame_id_;  // 当前连接已送达的最后一帧编号（不含只有关注区域的帧，-1表示无）
+
     // 状态
     ClientState current_state_;
     std::map<ClientState, std::function<void()>> state_handlers_;
 
+    // 全分辨率帧请求
+    struct FullFrameRequest {
+        int request_id = 0;             // 服务端引用的图像请求ID
+        int64_t frame_id = 0;           // 帧编号（优先于request_id）
+        FrameRect crop;                 // 裁剪区域（为空表示整帧）
+        int quality = 90;               // JPEG质量
+    };
+    std::queue<FullFrameRequest> full_frame_requests_;
+    std::mutex full_frame_mutex_;
+    std::deque<std::pair<int, int64_t>> sent_frame_ids_; // 已发送图像的请求ID与帧编号（由full_frame_mutex_保护）
+
+    // 连拍请求（只保留最新的一个）
+    BurstSettings pending_burst_;
+    int pending_burst_request_id_;
+    bool burst_pending_;
+    std::mutex burst_mutex_;
+
     // 动作队列
     std::queue<Action> action_queue_;
     std::mutex action_mutex_;
@@ -134,8 +285,13 @@ private:
     // 性能统计
     int action_counter_;
     int64_t last_action_time_;
-    int64_t last_capture_time_;
+    int64_t last_capture_time_;     // 上次发送图像时间
+    int64_t next_capture_time_;     // 下次捕获时间
+    int64_t next_scene_probe_time_; // 下次场景切换探测时间
     int64_t last_heartbeat_time_;
+    std::vector<int64_t> stream_capture_times_; // 各子流上次捕获时间
+    std::vector<size_t> due_streams_;           // 本次到期的子流（跨调用复用）
+    std::vector<std::shared_ptr<StreamCaptureResult>> stream_results_; // 子流捕获结果（跨调用复用）
     size_t last_image_hash_;
     int image_change_threshold_;
     int consecutive_errors_;
@@ -0,0 +1,58 @@
+#include "digest_cache.h"
+
+FrameDigestCache::FrameDigestCache(size_t capacity)
+    : capacity_(capacity) {
+}
+
+void FrameDigestCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    order_.clear();
+    index_.clear();
+}
+
+bool FrameDigestCache::touch(const FrameDigest& digest) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(digest);
+    if (it == index_.end()) {
+        return false;
+    }
+    order_.splice(order_.begin(), order_, it->second);
+    return true;
+}
+
+void FrameDigestCache::insert(const FrameDigest& digest) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0) {
+        return;
+    }
+
+    auto it = index_.find(digest);
+    if (it != index_.end()) {
+        order_.splice(order_.begin(), order_, it->second);
+        return;
+    }
+
+    order_.push_front(digest);
+    index_[digest] = order_.begin();
+    while (order_.size() > capacity_) {
+        index_.erase(order_.back());
+        order_.pop_back();
+    }
+}
+
+void FrameDigestCache::erase(const FrameDigest& digest) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(digest);
+    if (it == index_.end()) {
+        return;
+    }
+    order_.erase(it->second);
+    index_.erase(it);
+}
+
+void FrameDigestCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    order_.clear();
+    index_.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "frame_diff.h"
+
+// 服务端已确认缓存的帧摘要（LRU）：命中的帧只发送引用，不再编码和传输图像
+// 确认消息在接收线程中处理，各方法线程安全
+class FrameDigestCache {
+public:
+    explicit FrameDigestCache(size_t capacity = 0);
+
+    // 设置容量（会清空缓存），0表示禁用
+    void setCapacity(size_t capacity);
+    bool enabled() const { return capacity_ > 0; }
+
+    // 查找摘要，命中时移到最近使用的位置
+    bool touch(const FrameDigest& digest);
+
+    // 记录服务端已缓存的摘要，超出容量时淘汰最久未使用的
+    void insert(const FrameDigest& digest);
+
+    // 移除摘要（服务端报告缓存未命中）
+    void erase(const FrameDigest& digest);
+
+    // 清空缓存
+    void clear();
+
+private:
+    struct DigestHash {
+        size_t operator()(const FrameDigest& digest) const { return static_cast<size_t>(digest.low ^ digest.high); }
+    };
+
+    size_t capacity_;
+    std::list<FrameDigest> order_;   // 最近使用的在前
+    std::unordered_map<FrameDigest, std::list<FrameDigest>::iterator, DigestHash> index_;
+    std::mutex mutex_;
+};
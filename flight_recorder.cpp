@@ -0,0 +1,232 @@
+#include "flight_recorder.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+namespace {
+
+// 每条消息/动作保存的最大文本长度
+constexpr size_t MAX_EVENT_TEXT = 256;
+
+// 消息文本在图像数据字段处截断
+const char DATA_FIELD[] = "\"data\":\"";
+
+// 文件头
+const char RECORDER_MAGIC[8] = { 'D', 'N', 'F', 'R', 'E', 'C', '0', '1' };
+
+int64_t wallClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+void writeValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeBlob(std::ofstream& out, const void* data, size_t length) {
+    writeValue(out, static_cast<uint32_t>(length));
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(length));
+}
+
+// 记录：类型(u8) 时间(i64，微秒) 原始大小(u32) 描述(u32长度+文本) 数据块数(u32) 各数据块(u32长度+字节)
+void writeRecord(std::ofstream& out, FlightRecorder::EventKind kind, int64_t time_us, uint32_t size,
+                 const std::string& meta, const std::vector<const std::vector<uint8_t>*>& blobs) {
+    writeValue(out, static_cast<uint8_t>(kind));
+    writeValue(out, time_us);
+    writeValue(out, size);
+    writeBlob(out, meta.data(), meta.size());
+    writeValue(out, static_cast<uint32_t>(blobs.size()));
+    for (const std::vector<uint8_t>* blob : blobs) {
+        writeBlob(out, blob->data(), blob->size());
+    }
+}
+
+void writeRects(std::ostream& meta, const std::vector<EncodedPatch>& patches) {
+    meta << "[";
+    for (size_t i = 0; i < patches.size(); i++) {
+        const FrameRect& rect = patches[i].rect;
+        meta << (i > 0 ? "," : "") << "[" << rect.x << "," << rect.y << "," << rect.width << "," << rect.height << "]";
+    }
+    meta << "]";
+}
+
+} // namespace
+
+FlightRecorder::FlightRecorder()
+    : window_us_(0), next_frame_(0), next_event_(0) {
+}
+
+void FlightRecorder::configure(int window_seconds, size_t max_frames, size_t max_events) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_us_ = static_cast<int64_t>(std::max(window_seconds, 1)) * 1000000;
+    frames_.clear();
+    frames_.resize(max_frames);
+    next_frame_ = 0;
+    events_.clear();
+    events_.resize(max_frames > 0 ? max_events : 0);
+    next_event_ = 0;
+
+    // 预先分配文本容量，记录时不再分配内存
+    for (EventEntry& entry : events_) {
+        entry.text.reserve(MAX_EVENT_TEXT);
+    }
+}
+
+void FlightRecorder::recordFrame(const std::shared_ptr<CaptureResult>& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frames_.empty()) {
+        return;
+    }
+
+    // 覆盖最旧的槽位，被替换的结果随之归还对象池
+    FrameEntry& entry = frames_[next_frame_];
+    entry.time_us = wallClockMicros();
+    entry.frame = frame;
+    next_frame_ = (next_frame_ + 1) % frames_.size();
+}
+
+void FlightRecorder::recordMessage(bool outgoing, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (events_.empty()) {
+        return;
+    }
+
+    EventEntry& entry = events_[next_event_];
+    entry.time_us = wallClockMicros();
+    entry.kind = outgoing ? EventKind::MESSAGE_OUT : EventKind::MESSAGE_IN;
+    entry.size = static_cast<uint32_t>(message.size());
+    // 只在保存范围内查找图像数据字段，不扫描整条大消息
+    size_t length = std::min(message.size(), MAX_EVENT_TEXT);
+    std::string_view head(message.data(), std::min(message.size(), MAX_EVENT_TEXT + sizeof(DATA_FIELD)));
+    size_t data_pos = head.find(DATA_FIELD);
+    if (data_pos < length) {
+        length = data_pos;
+    }
+    entry.text.assign(message, 0, length);
+    next_event_ = (next_event_ + 1) % events_.size();
+}
+
+void FlightRecorder::recordEvent(EventKind kind, const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (events_.empty()) {
+        return;
+    }
+
+    EventEntry& entry = events_[next_event_];
+    entry.time_us = wallClockMicros();
+    entry.kind = kind;
+    entry.size = static_cast<uint32_t>(text.size());
+    entry.text.assign(text, 0, std::min(text.size(), MAX_EVENT_TEXT));
+    next_event_ = (next_event_ + 1) % events_.size();
+}
+
+bool FlightRecorder::dump(const std::string& path, const std::string& reason) {
+    // 在锁内复制引用和文本，写文件时不阻塞记录
+    std::vector<FrameEntry> frames;
+    std::vector<EventEntry> events;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (frames_.empty()) {
+            return false;
+        }
+
+        int64_t since_us = wallClockMicros() - window_us_;
+        for (size_t i = 0; i < frames_.size(); i++) {
+            const FrameEntry& entry = frames_[(next_frame_ + i) % frames_.size()];
+            if (entry.frame && entry.time_us >= since_us) {
+                frames.push_back(entry);
+            }
+        }
+        for (size_t i = 0; i < events_.size(); i++) {
+            const EventEntry& entry = events_[(next_event_ + i) % events_.size()];
+            if (entry.time_us > 0 && entry.time_us >= since_us) {
+                events.push_back(entry);
+            }
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        logError_fmt("无法创建飞行记录文件: {}", path);
+        return false;
+    }
+
+    out.write(RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+    writeRecord(out, EventKind::STATE, wallClockMicros(), static_cast<uint32_t>(reason.size()), reason, {});
+
+    // 帧和事件各自按时间有序，归并写出
+    size_t frame_index = 0;
+    size_t event_index = 0;
+    size_t frame_bytes = 0;
+    std::vector<const std::vector<uint8_t>*> blobs;
+    while (frame_index < frames.size() || event_index < events.size()) {
+        bool take_frame = event_index >= events.size() ||
+            (frame_index < frames.size() && frames[frame_index].time_us <= events[event_index].time_us);
+
+        if (!take_frame) {
+            const EventEntry& event = events[event_index++];
+            writeRecord(out, event.kind, event.time_us, event.size, event.text, {});
+            continue;
+        }
+
+        const FrameEntry& entry = frames[frame_index++];
+        const CaptureResult& frame = *entry.frame;
+        const char* type = frame.roi_only ? "image_roi"
+                         : frame.is_keyframe ? (frame.content_cached ? "image_ref" : "image")
+                         : frame.is_pan ? "image_pan" : "image_delta";
+
+        // 描述：帧信息和各数据块对应的区域，数据块依次为整帧、增量区域、关注区域、界面层
+        std::ostringstream meta;
+        meta << "{\"type\":\"" << type << "\",\"frame_id\":" << frame.frame_id
+             << ",\"keyframe_id\":" << frame.keyframe_id
+             << ",\"width\":" << frame.width << ",\"height\":" << frame.height;
+        if (frame.lossless) {
+            meta << ",\"format\":\"qoi\"";
+        }
+        if (frame.is_pan) {
+            meta << ",\"pan\":[" << frame.pan_dx << "," << frame.pan_dy << "]";
+        }
+        meta << ",\"patches\":";
+        writeRects(meta, frame.patches);
+        meta << ",\"regions\":";
+        writeRects(meta, frame.regions);
+        meta << ",\"overlays\":";
+        writeRects(meta, frame.overlays);
+        meta << "}";
+
+        blobs.clear();
+        size_t size = 0;
+        if (!frame.jpeg_data.empty()) {
+            blobs.push_back(&frame.jpeg_data);
+            size += frame.jpeg_data.size();
+        }
+        for (const EncodedPatch& patch : frame.patches) {
+            blobs.push_back(&patch.data);
+            size += patch.data.size();
+        }
+        for (const EncodedPatch& patch : frame.regions) {
+            blobs.push_back(&patch.data);
+            size += patch.data.size();
+        }
+        for (const EncodedPatch& patch : frame.overlays) {
+            blobs.push_back(&patch.data);
+            size += patch.data.size();
+        }
+        frame_bytes += size;
+        writeRecord(out, EventKind::FRAME, entry.time_us, static_cast<uint32_t>(size), meta.str(), blobs);
+    }
+
+    out.close();
+    if (!out) {
+        logError_fmt("写入飞行记录文件失败: {}", path);
+        return false;
+    }
+
+    logInfo_fmt("已写入飞行记录: {}，原因: {}，帧: {} ({} KB)，事件: {}",
+        path, reason, frames.size(), frame_bytes / 1024, events.size());
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "screen_capture.h"
+
+// 飞行记录器：在固定大小的环形缓冲区中保留最近一段时间发送的帧、收发的消息和执行的动作
+// 帧只保留捕获结果的引用（对象池中的编码缓冲区），不复制图像数据
+// 只在进入错误状态或按需时写入文件，平时的开销只有一次加锁和引用赋值
+class FlightRecorder {
+public:
+    // 事件类型
+    enum class EventKind : uint8_t {
+        FRAME = 1,                   // 发送的帧
+        MESSAGE_OUT = 2,             // 发送的消息
+        MESSAGE_IN = 3,              // 收到的消息
+        ACTION = 4,                  // 执行的动作
+        STATE = 5,                   // 状态转换
+        DROP = 6                     // 未发送的帧（发送队列溢出或参考帧已丢弃），文本为帧编号
+    };
+
+    FlightRecorder();
+
+    // 设置记录窗口：保留最近window_seconds秒，最多max_frames帧和max_events条事件（会清空记录）
+    // max_frames为0时禁用记录
+    void configure(int window_seconds, size_t max_frames, size_t max_events);
+    bool enabled() const { return !frames_.empty(); }
+    size_t frameCapacity() const { return frames_.size(); }
+
+    // 记录已送达的帧（只保留引用）
+    void recordFrame(const std::shared_ptr<CaptureResult>& frame);
+
+    // 记录消息：保存原始大小和开头部分的文本（最多256字节，截止到第一个"data"字段之前）
+    // 图像消息因此只保留类型、请求ID、帧编号等字段，不保存base64图像数据
+    void recordMessage(bool outgoing, const std::string& message);
+
+    // 记录动作或状态转换
+    void recordEvent(EventKind kind, const std::string& text);
+
+    // 将记录窗口内的内容写入文件，返回是否成功
+    bool dump(const std::string& path, const std::string& reason);
+
+private:
+    struct FrameEntry {
+        int64_t time_us = 0;
+        std::shared_ptr<CaptureResult> frame;
+    };
+
+    struct EventEntry {
+        int64_t time_us = 0;
+        EventKind kind = EventKind::ACTION;
+        uint32_t size = 0;           // 原始消息大小
+        std::string text;            // 文本（可能被截断，容量随槽位复用）
+    };
+
+    int64_t window_us_;
+    std::vector<FrameEntry> frames_;
+    size_t next_frame_;
+    std::vector<EventEntry> events_;
+    size_t next_event_;
+    std::mutex mutex_;
+};
@@ -0,0 +1,594 @@
+#include "frame_diff.h"
+#include "simd_util.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// splitmix64终结函数，用于混合累加器
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 合并瓦片累加器为最终哈希
+inline uint64_t finalizeTileHash(const uint64_t* lanes, int lane_count, uint64_t tail_a, uint64_t tail_b) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < lane_count; i++) {
+        h = mix64(h ^ lanes[i]);
+    }
+    h = mix64(h ^ tail_a);
+    return mix64(h ^ tail_b);
+}
+
+// 行尾不足一个向量宽度的像素（4字节对齐）按标量累加
+inline void accumulateTail(const uint8_t* p, int bytes, uint64_t& a, uint64_t& b) {
+    for (int i = 0; i < bytes; i += 4) {
+        uint32_t v;
+        memcpy(&v, p + i, 4);
+        a += v;
+        b += a;
+    }
+}
+
+#ifndef FRAME_SIMD_X86
+
+// 标量实现：按64位字做Fletcher式双累加（b对位置敏感）
+uint64_t hashTileScalar(const uint8_t* data, int stride, int row_bytes, int rows) {
+    uint64_t a = 0;
+    uint64_t b = 0;
+    uint64_t ta = 0;
+    uint64_t tb = 0;
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* p = data + static_cast<size_t>(y) * stride;
+        int i = 0;
+        for (; i + 8 <= row_bytes; i += 8) {
+            uint64_t v;
+            memcpy(&v, p + i, 8);
+            a += v;
+            b += a;
+        }
+        accumulateTail(p + i, row_bytes - i, ta, tb);
+    }
+
+    uint64_t lanes[2] = { a, b };
+    return finalizeTileHash(lanes, 2, ta, tb);
+}
+
+#else
+
+// SSE2实现：16字节向量上的双累加
+uint64_t hashTileSse2(const uint8_t* data, int stride, int row_bytes, int rows) {
+    __m128i a = _mm_setzero_si128();
+    __m128i b = _mm_setzero_si128();
+    uint64_t ta = 0;
+    uint64_t tb = 0;
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* p = data + static_cast<size_t>(y) * stride;
+        int i = 0;
+        for (; i + 16 <= row_bytes; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            a = _mm_add_epi64(a, v);
+            b = _mm_add_epi64(b, a);
+        }
+        accumulateTail(p + i, row_bytes - i, ta, tb);
+    }
+
+    alignas(16) uint64_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), a);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes + 2), b);
+    return finalizeTileHash(lanes, 4, ta, tb);
+}
+
+// AVX2实现：32字节向量上的双累加
+SIMD_TARGET_AVX2
+uint64_t hashTileAvx2(const uint8_t* data, int stride, int row_bytes, int rows) {
+    __m256i a = _mm256_setzero_si256();
+    __m256i b = _mm256_setzero_si256();
+    uint64_t ta = 0;
+    uint64_t tb = 0;
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* p = data + static_cast<size_t>(y) * stride;
+        int i = 0;
+        for (; i + 32 <= row_bytes; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            a = _mm256_add_epi64(a, v);
+            b = _mm256_add_epi64(b, a);
+        }
+        accumulateTail(p + i, row_bytes - i, ta, tb);
+    }
+
+    alignas(32) uint64_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), a);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes + 4), b);
+    return finalizeTileHash(lanes, 8, ta, tb);
+}
+
+#endif
+
+using TileHashFunc = uint64_t (*)(const uint8_t*, int, int, int);
+
+// 根据CPU特性选择瓦片哈希实现（进程内固定，保证帧间哈希可比）
+TileHashFunc selectTileHash() {
+#ifdef FRAME_SIMD_X86
+    if (cpuHasAvx2()) {
+        return hashTileAvx2;
+    }
+    return hashTileSse2;
+#else
+    return hashTileScalar;
+#endif
+}
+
+} // namespace
+
+// ==================== DirtyTileMap ====================
+
+void DirtyTileMap::reset(int frame_width, int frame_height, int tile) {
+    tile_size = tile;
+    tiles_x = (frame_width + tile - 1) / tile;
+    tiles_y = (frame_height + tile - 1) / tile;
+    bits.assign((static_cast<size_t>(tiles_x) * tiles_y + 7) / 8, 0);
+}
+
+void DirtyTileMap::setAll() {
+    std::fill(bits.begin(), bits.end(), 0xFF);
+
+    // 清除末尾多余的位，保证dirtyCount准确
+    size_t count = static_cast<size_t>(tiles_x) * tiles_y;
+    if (count % 8 != 0 && !bits.empty()) {
+        bits.back() = static_cast<uint8_t>((1 << (count % 8)) - 1);
+    }
+}
+
+int DirtyTileMap::dirtyCount() const {
+    int count = 0;
+    for (uint8_t byte : bits) {
+        for (uint8_t v = byte; v; v &= v - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool DirtyTileMap::any() const {
+    return std::any_of(bits.begin(), bits.end(), [](uint8_t byte) { return byte != 0; });
+}
+
+bool DirtyTileMap::anyInRect(const FrameRect& rect) const {
+    if (rect.empty() || tile_size <= 0) {
+        return false;
+    }
+
+    int tx0 = std::max(rect.x / tile_size, 0);
+    int ty0 = std::max(rect.y / tile_size, 0);
+    int tx1 = std::min((rect.x + rect.width - 1) / tile_size, tiles_x - 1);
+    int ty1 = std::min((rect.y + rect.height - 1) / tile_size, tiles_y - 1);
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            if (isDirty(tx, ty)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void DirtyTileMap::clearRect(const FrameRect& rect) {
+    if (rect.empty() || tile_size <= 0) {
+        return;
+    }
+
+    int tx0 = std::max(rect.x / tile_size, 0);
+    int ty0 = std::max(rect.y / tile_size, 0);
+    int tx1 = std::min((rect.x + rect.width - 1) / tile_size, tiles_x - 1);
+    int ty1 = std::min((rect.y + rect.height - 1) / tile_size, tiles_y - 1);
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            size_t index = static_cast<size_t>(ty) * tiles_x + tx;
+            bits[index >> 3] &= static_cast<uint8_t>(~(1 << (index & 7)));
+        }
+    }
+}
+
+FrameRect DirtyTileMap::tileRect(int tx, int ty, int frame_width, int frame_height) const {
+    FrameRect rect;
+    rect.x = tx * tile_size;
+    rect.y = ty * tile_size;
+    rect.width = std::min(tile_size, frame_width - rect.x);
+    rect.height = std::min(tile_size, frame_height - rect.y);
+    return rect;
+}
+
+// ==================== 瓦片哈希 ====================
+
+void computeTileHashes(const RawFrame& frame, int tile_size, std::vector<uint64_t>& hashes) {
+    static const TileHashFunc hash_tile = selectTileHash();
+
+    int tiles_x = (frame.width + tile_size - 1) / tile_size;
+    int tiles_y = (frame.height + tile_size - 1) / tile_size;
+    hashes.resize(static_cast<size_t>(tiles_x) * tiles_y);
+
+    for (int ty = 0; ty < tiles_y; ty++) {
+        int y = ty * tile_size;
+        int rows = std::min(tile_size, frame.height - y);
+        const uint8_t* band = frame.row(y);
+
+        for (int tx = 0; tx < tiles_x; tx++) {
+            int x = tx * tile_size;
+            int row_bytes = std::min(tile_size, frame.width - x) * 4;
+            hashes[static_cast<size_t>(ty) * tiles_x + tx] =
+                hash_tile(band + static_cast<size_t>(x) * 4, frame.stride, row_bytes, rows);
+        }
+    }
+}
+
+bool compareTileHashes(const std::vector<uint64_t>& current, const std::vector<uint64_t>& reference,
+                       DirtyTileMap& dirty) {
+    if (current.size() != reference.size() ||
+        current.size() != static_cast<size_t>(dirty.tileCount())) {
+        dirty.setAll();
+        return true;
+    }
+
+    bool changed = false;
+    for (int ty = 0; ty < dirty.tiles_y; ty++) {
+        for (int tx = 0; tx < dirty.tiles_x; tx++) {
+            size_t index = static_cast<size_t>(ty) * dirty.tiles_x + tx;
+            if (current[index] != reference[index]) {
+                dirty.setDirty(tx, ty);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+void mergeDirtyTiles(const DirtyTileMap& dirty, int frame_width, int frame_height, std::vector<FrameRect>& rects) {
+    // 上一瓦片行中仍可向下延伸的矩形（每个线程复用同一组缓冲区）
+    static thread_local std::vector<size_t> open_rects;
+    static thread_local std::vector<size_t> next_open;
+    rects.clear();
+    open_rects.clear();
+
+    for (int ty = 0; ty < dirty.tiles_y; ty++) {
+        next_open.clear();
+        int tx = 0;
+        while (tx < dirty.tiles_x) {
+            if (!dirty.isDirty(tx, ty)) {
+                tx++;
+                continue;
+            }
+
+            // 同一行相邻脏瓦片合并为一段
+            int run_start = tx;
+            while (tx < dirty.tiles_x && dirty.isDirty(tx, ty)) {
+                tx++;
+            }
+
+            FrameRect first = dirty.tileRect(run_start, ty, frame_width, frame_height);
+            FrameRect last = dirty.tileRect(tx - 1, ty, frame_width, frame_height);
+            int x = first.x;
+            int width = last.x + last.width - first.x;
+
+            // 与上一行横向范围完全一致的矩形向下延伸
+            bool extended = false;
+            for (size_t index : open_rects) {
+                FrameRect& rect = rects[index];
+                if (rect.x == x && rect.width == width) {
+                    rect.height += first.height;
+                    next_open.push_back(index);
+                    extended = true;
+                    break;
+                }
+            }
+
+            if (!extended) {
+                rects.push_back({ x, first.y, width, first.height });
+                next_open.push_back(rects.size() - 1);
+            }
+        }
+        std::swap(open_rects, next_open);
+    }
+}
+
+// ==================== 帧摘要 ====================
+
+namespace {
+
+constexpr uint64_t DIGEST_PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t DIGEST_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t digestRound(uint64_t acc, uint64_t input) {
+    acc += input * DIGEST_PRIME_2;
+    return rotl64(acc, 31) * DIGEST_PRIME_1;
+}
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+} // namespace
+
+std::string FrameDigest::toHex() const {
+    char buffer[33];
+    snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+        static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+    return buffer;
+}
+
+bool FrameDigest::fromHex(const std::string& hex, FrameDigest& digest) {
+    if (hex.size() != 32 || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        return false;
+    }
+    digest.high = std::strtoull(hex.substr(0, 16).c_str(), nullptr, 16);
+    digest.low = std::strtoull(hex.substr(16).c_str(), nullptr, 16);
+    return true;
+}
+
+FrameDigest computeFrameDigest(const RawFrame& frame, uint64_t seed) {
+    // 四路独立累加器，每次处理32字节
+    uint64_t v1 = seed + DIGEST_PRIME_1 + DIGEST_PRIME_2;
+    uint64_t v2 = seed + DIGEST_PRIME_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - DIGEST_PRIME_1;
+
+    int row_bytes = frame.width * 4;
+    for (int y = 0; y < frame.height; y++) {
+        const uint8_t* p = frame.row(y);
+        int i = 0;
+        for (; i + 32 <= row_bytes; i += 32) {
+            v1 = digestRound(v1, load64(p + i));
+            v2 = digestRound(v2, load64(p + i + 8));
+            v3 = digestRound(v3, load64(p + i + 16));
+            v4 = digestRound(v4, load64(p + i + 24));
+        }
+        // 行尾不足32字节的部分（像素4字节对齐）
+        for (; i + 8 <= row_bytes; i += 8) {
+            v1 = digestRound(v1, load64(p + i));
+        }
+        if (i < row_bytes) {
+            uint32_t v;
+            memcpy(&v, p + i, 4);
+            v2 = digestRound(v2, v);
+        }
+    }
+
+    // 两种不同的合并顺序得到高低64位，尺寸也参与混合
+    uint64_t size = (static_cast<uint64_t>(frame.width) << 32) | static_cast<uint32_t>(frame.height);
+    FrameDigest digest;
+    digest.low = mix64(v1 ^ mix64(v2 ^ mix64(v3 ^ mix64(v4 ^ size))));
+    digest.high = mix64(v4 + mix64(v3 + mix64(v2 + mix64(v1 + size + DIGEST_PRIME_1))));
+    return digest;
+}
+
+// ==================== TileChangeDetector ====================
+
+TileChangeDetector::TileChangeDetector(int tile_size)
+    : tile_size_(tile_size > 0 ? tile_size : 32), frame_width_(0), frame_height_(0) {
+}
+
+void TileChangeDetector::setTileSize(int tile_size) {
+    if (tile_size <= 0) {
+        logWarn_fmt("无效的瓦片大小: {}，保持 {}", tile_size, tile_size_);
+        return;
+    }
+    tile_size_ = tile_size;
+    reset();
+}
+
+void TileChangeDetector::reset() {
+    frame_width_ = 0;
+    frame_height_ = 0;
+    current_hashes_.clear();
+    previous_hashes_.clear();
+}
+
+bool TileChangeDetector::detect(const RawFrame& frame, DirtyTileMap& dirty) {
+    dirty.reset(frame.width, frame.height, tile_size_);
+
+    std::swap(current_hashes_, previous_hashes_);
+    computeTileHashes(frame, tile_size_, current_hashes_);
+
+    // 首帧或尺寸变化：全部视为脏
+    if (frame.width != frame_width_ || frame.height != frame_height_ ||
+        previous_hashes_.size() != current_hashes_.size()) {
+        frame_width_ = frame.width;
+        frame_height_ = frame.height;
+        dirty.setAll();
+        return true;
+    }
+
+    return compareTileHashes(current_hashes_, previous_hashes_, dirty);
+}
+
+// ==================== 感知变化度量 ====================
+
+void computeBlockLuma(const RawFrame& frame, std::vector<uint8_t>& blocks, int& blocks_x, int& blocks_y) {
+    blocks_x = frame.width / LUMA_BLOCK_SIZE;
+    blocks_y = frame.height / LUMA_BLOCK_SIZE;
+    blocks.resize(static_cast<size_t>(blocks_x) * blocks_y);
+    if (blocks.empty()) {
+        return;
+    }
+
+    const uint32_t divisor = LUMA_BLOCK_SIZE * LUMA_BLOCK_SIZE * 3;
+#ifdef FRAME_SIMD_X86
+    const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+#endif
+
+    // 逐块累加块内各行（一个块行的8行数据留在缓存中），不需要额外的列累加缓冲区
+    for (int by = 0; by < blocks_y; by++) {
+        const uint8_t* block_row = frame.row(by * LUMA_BLOCK_SIZE);
+        uint8_t* out = blocks.data() + static_cast<size_t>(by) * blocks_x;
+
+        for (int bx = 0; bx < blocks_x; bx++) {
+            const uint8_t* block = block_row + bx * LUMA_BLOCK_SIZE * 4;
+            uint32_t sum = 0;
+#ifdef FRAME_SIMD_X86
+            // 屏蔽Alpha后与0做SAD，一次得到8个像素的B+G+R之和
+            __m128i acc = _mm_setzero_si128();
+            for (int y = 0; y < LUMA_BLOCK_SIZE; y++) {
+                const __m128i* p = reinterpret_cast<const __m128i*>(block + static_cast<size_t>(y) * frame.stride);
+                __m128i v0 = _mm_and_si128(_mm_loadu_si128(p), color_mask);
+                __m128i v1 = _mm_and_si128(_mm_loadu_si128(p + 1), color_mask);
+                acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_sad_epu8(v0, zero), _mm_sad_epu8(v1, zero)));
+            }
+            sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#else
+            for (int y = 0; y < LUMA_BLOCK_SIZE; y++) {
+                const uint8_t* p = block + static_cast<size_t>(y) * frame.stride;
+                for (int x = 0; x < LUMA_BLOCK_SIZE; x++) {
+                    sum += p[x * 4] + p[x * 4 + 1] + p[x * 4 + 2];
+                }
+            }
+#endif
+            out[bx] = static_cast<uint8_t>((sum + divisor / 2) / divisor);
+        }
+    }
+}
+
+uint64_t blockLumaDistance(const std::vector<uint8_t>& current, const std::vector<uint8_t>& reference,
+                           int noise_floor) {
+    size_t count = std::min(current.size(), reference.size());
+    uint8_t floor = static_cast<uint8_t>(std::min(std::max(noise_floor, 0), 255));
+    uint64_t distance = 0;
+    size_t i = 0;
+
+#ifdef FRAME_SIMD_X86
+    // |a-b| = (a-b饱和) | (b-a饱和)，再饱和减去噪声阈值，最后用SAD求和
+    const __m128i floor_vec = _mm_set1_epi8(static_cast<char>(floor));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current.data() + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference.data() + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        diff = _mm_subs_epu8(diff, floor_vec);
+        total = _mm_add_epi64(total, _mm_sad_epu8(diff, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+    distance = lanes[0] + lanes[1];
+#endif
+
+    for (; i < count; i++) {
+        int diff = std::abs(static_cast<int>(current[i]) - static_cast<int>(reference[i]));
+        if (diff > floor) {
+            distance += diff - floor;
+        }
+    }
+
+    return distance;
+}
+
+PerceptualChangeMetric::PerceptualChangeMetric()
+    : threshold_(0), noise_floor_(0), blocks_x_(0), blocks_y_(0),
+      reference_blocks_x_(0), reference_blocks_y_(0), has_reference_(false), last_distance_(0) {
+}
+
+void PerceptualChangeMetric::setParameters(int threshold, int noise_floor) {
+    threshold_ = std::max(threshold, 0);
+    noise_floor_ = std::min(std::max(noise_floor, 0), 255);
+    has_reference_ = false;
+}
+
+void PerceptualChangeMetric::measure(const RawFrame& frame) {
+    computeBlockLuma(frame, current_, blocks_x_, blocks_y_);
+}
+
+bool PerceptualChangeMetric::exceedsThreshold(const RawFrame& frame) {
+    measure(frame);
+
+    if (!has_reference_ || blocks_x_ != reference_blocks_x_ || blocks_y_ != reference_blocks_y_) {
+        last_distance_ = UINT64_MAX;
+        return true;
+    }
+
+    // 按块数归一化，同样大小的界面变化在不同分辨率下得到相同的距离
+    uint64_t block_count = static_cast<uint64_t>(blocks_x_) * blocks_y_;
+    last_distance_ = block_count > 0
+        ? blockLumaDistance(current_, reference_, noise_floor_) * 1000 / block_count : 0;
+    return last_distance_ >= static_cast<uint64_t>(threshold_);
+}
+
+void PerceptualChangeMetric::commit() {
+    reference_.swap(current_);
+    reference_blocks_x_ = blocks_x_;
+    reference_blocks_y_ = blocks_y_;
+    has_reference_ = true;
+}
+
+// ==================== 场景切换检测 ====================
+
+namespace {
+
+constexpr int SCENE_HISTOGRAM_BINS = 64;
+constexpr int SCENE_SAMPLE_STEP = 4;
+
+} // namespace
+
+SceneChangeDetector::SceneChangeDetector()
+    : threshold_(0), has_previous_(false), last_distance_(0),
+      histogram_(SCENE_HISTOGRAM_BINS), previous_(SCENE_HISTOGRAM_BINS) {
+}
+
+bool SceneChangeDetector::detect(const RawFrame& frame) {
+    if (!frame.valid()) {
+        return false;
+    }
+
+    std::swap(histogram_, previous_);
+    std::fill(histogram_.begin(), histogram_.end(), 0);
+
+    // 亮度近似为(B + 2G + R) / 4，再量化为64级
+    uint32_t samples = 0;
+    for (int y = 0; y < frame.height; y += SCENE_SAMPLE_STEP) {
+        const uint8_t* row = frame.row(y);
+        for (int x = 0; x < frame.width; x += SCENE_SAMPLE_STEP) {
+            const uint8_t* p = row + x * 4;
+            int luma = (p[0] + 2 * p[1] + p[2]) >> 2;
+            histogram_[luma >> 2]++;
+            samples++;
+        }
+    }
+
+    bool had_previous = has_previous_;
+    has_previous_ = true;
+    if (!had_previous) {
+        last_distance_ = 0;
+        return false;
+    }
+
+    uint64_t distance = 0;
+    uint64_t previous_samples = 0;
+    for (int i = 0; i < SCENE_HISTOGRAM_BINS; i++) {
+        distance += static_cast<uint64_t>(std::abs(static_cast<int64_t>(histogram_[i]) - previous_[i]));
+        previous_samples += previous_[i];
+    }
+
+    // 尺寸变化时样本数不同，直接视为场景切换
+    if (previous_samples != samples) {
+        last_distance_ = 2.0;
+        return true;
+    }
+
+    last_distance_ = static_cast<double>(distance) / samples;
+    return last_distance_ >= threshold_;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "frame_source.h"
+
+// 脏瓦片位图：帧按tile_size×tile_size划分，每个瓦片1位（行优先）
+struct DirtyTileMap {
+    int tile_size = 32;              // 瓦片边长（像素）
+    int tiles_x = 0;                 // 横向瓦片数
+    int tiles_y = 0;                 // 纵向瓦片数
+    std::vector<uint8_t> bits;       // 位图数据
+
+    // 重置为指定尺寸的空位图
+    void reset(int frame_width, int frame_height, int tile);
+
+    // 标记全部瓦片为脏
+    void setAll();
+
+    bool isDirty(int tx, int ty) const {
+        size_t index = static_cast<size_t>(ty) * tiles_x + tx;
+        return (bits[index >> 3] >> (index & 7)) & 1;
+    }
+
+    void setDirty(int tx, int ty) {
+        size_t index = static_cast<size_t>(ty) * tiles_x + tx;
+        bits[index >> 3] |= static_cast<uint8_t>(1 << (index & 7));
+    }
+
+    // 脏瓦片数量
+    int dirtyCount() const;
+
+    // 是否存在脏瓦片
+    bool any() const;
+
+    // 与指定像素矩形相交的瓦片中是否存在脏瓦片
+    bool anyInRect(const FrameRect& rect) const;
+
+    // 清除与指定像素矩形相交的瓦片
+    void clearRect(const FrameRect& rect);
+
+    // 瓦片总数
+    int tileCount() const { return tiles_x * tiles_y; }
+
+    // 瓦片在帧中的像素矩形（边缘瓦片会被裁剪）
+    FrameRect tileRect(int tx, int ty, int frame_width, int frame_height) const;
+};
+
+// 计算帧每个瓦片的64位哈希（SSE2/AVX2向量化，非x86平台使用标量实现）
+void computeTileHashes(const RawFrame& frame, int tile_size, std::vector<uint64_t>& hashes);
+
+// 比较两组瓦片哈希（dirty需已按帧尺寸reset），返回是否存在不同的瓦片
+bool compareTileHashes(const std::vector<uint64_t>& current, const std::vector<uint64_t>& reference,
+                       DirtyTileMap& dirty);
+
+// 将脏瓦片合并为矩形：先合并同一行相邻瓦片，再合并上下对齐的行段（rects被覆盖，容量跨帧复用）
+void mergeDirtyTiles(const DirtyTileMap& dirty, int frame_width, int frame_height, std::vector<FrameRect>& rects);
+
+// 帧内容的128位摘要（用于服务端帧缓存的去重）
+struct FrameDigest {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool empty() const { return high == 0 && low == 0; }
+    bool operator==(const FrameDigest& other) const { return high == other.high && low == other.low; }
+
+    // 32位十六进制字符串
+    std::string toHex() const;
+    static bool fromHex(const std::string& hex, FrameDigest& digest);
+};
+
+// 计算整帧像素的128位摘要：四路64位乘法-旋转累加（xxHash64的轮函数），按行处理步长
+// seed混入编码参数（输出尺寸等），同一画面按不同参数编码时摘要不同
+FrameDigest computeFrameDigest(const RawFrame& frame, uint64_t seed);
+
+// 基于原始像素瓦片哈希的帧变化检测器
+class TileChangeDetector {
+public:
+    explicit TileChangeDetector(int tile_size = 32);
+
+    // 设置瓦片大小（会重置历史）
+    void setTileSize(int tile_size);
+    int getTileSize() const { return tile_size_; }
+
+    // 计算当前帧的瓦片哈希并与上一帧比较，输出脏瓦片位图
+    // 返回是否有瓦片发生变化（首帧或尺寸变化时全部为脏）
+    bool detect(const RawFrame& frame, DirtyTileMap& dirty);
+
+    // 清除历史，下一帧视为全部变化
+    void reset();
+
+    // 最近一帧的瓦片哈希
+    const std::vector<uint64_t>& tileHashes() const { return current_hashes_; }
+
+private:
+    int tile_size_;
+    int frame_width_;
+    int frame_height_;
+    std::vector<uint64_t> current_hashes_;
+    std::vector<uint64_t> previous_hashes_;
+};
+
+// 块亮度的块边长（像素）
+constexpr int LUMA_BLOCK_SIZE = 8;
+
+// 计算帧的块亮度：每个8×8块取(B+G+R)/3的平均值（不足一块的右/下边缘忽略，SSE2向量化）
+void computeBlockLuma(const RawFrame& frame, std::vector<uint8_t>& blocks, int& blocks_x, int& blocks_y);
+
+// 两组块亮度的距离：逐块|差|减去noise_floor后求和（小于噪声阈值的差异视为0）
+uint64_t blockLumaDistance(const std::vector<uint8_t>& current, const std::vector<uint8_t>& reference,
+                           int noise_floor);
+
+// 感知变化度量：比较当前帧与上次发送帧的块亮度，忽略粒子特效、UI闪烁等细小变化
+class PerceptualChangeMetric {
+public:
+    PerceptualChangeMetric();
+
+    // threshold为归一化的块亮度距离阈值（0表示禁用），noise_floor为单块忽略的亮度差
+    // 归一化距离 = 块亮度距离 × 1000 / 块数，即"千分之一的块变化1个亮度级"为1，与分辨率无关
+    // 例如1080p（32400块）中3个块各变化60级为5，整帧每块变化2级为2000
+    void setParameters(int threshold, int noise_floor);
+    bool enabled() const { return threshold_ > 0; }
+
+    // 计算当前帧的块亮度，返回相对参考帧的距离是否达到阈值（无参考帧或尺寸变化时返回true）
+    bool exceedsThreshold(const RawFrame& frame);
+
+    // 只计算当前帧的块亮度（跳过了阈值判断但仍要发送的帧，commit前调用）
+    void measure(const RawFrame& frame);
+
+    // 将最近一次计算的块亮度设为参考帧（帧被编码发送后调用）
+    void commit();
+
+    // 清除参考帧
+    void reset() { has_reference_ = false; }
+
+    // 最近一次计算的归一化距离（与阈值同单位）
+    uint64_t lastDistance() const { return last_distance_; }
+
+private:
+    int threshold_;
+    int noise_floor_;
+    int blocks_x_;
+    int blocks_y_;
+    int reference_blocks_x_;
+    int reference_blocks_y_;
+    bool has_reference_;
+    uint64_t last_distance_;
+    std::vector<uint8_t> current_;
+    std::vector<uint8_t> reference_;
+};
+
+// 场景切换检测：比较相邻两次检查帧的亮度直方图（64级，隔4行4列采样）
+// 房间切换、加载画面、对话框等整屏变化会使直方图分布大幅移动
+class SceneChangeDetector {
+public:
+    SceneChangeDetector();
+
+    // 设置阈值：直方图L1距离（0-2，即移动的分布比例×2），0表示禁用
+    void setThreshold(double threshold) { threshold_ = threshold; reset(); }
+    bool enabled() const { return threshold_ > 0; }
+
+    // 检查帧并更新历史，返回相对上一检查帧是否发生场景切换（首帧返回false）
+    bool detect(const RawFrame& frame);
+
+    // 清除历史
+    void reset() { has_previous_ = false; }
+
+    // 最近一次的直方图距离
+    double lastDistance() const { return last_distance_; }
+
+private:
+    double threshold_;
+    bool has_previous_;
+    double last_distance_;
+    std::vector<uint32_t> histogram_;
+    std::vector<uint32_t> previous_;
+};
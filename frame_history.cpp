@@ -0,0 +1,54 @@
+#include "frame_history.h"
+#include <cstring>
+
+FrameHistory::FrameHistory(size_t capacity)
+    : next_slot_(0) {
+    setCapacity(capacity);
+}
+
+void FrameHistory::setCapacity(size_t capacity) {
+    slots_.clear();
+    slots_.resize(capacity);
+    next_slot_ = 0;
+}
+
+void FrameHistory::store(int64_t frame_id, const RawFrame& frame) {
+    if (slots_.empty() || !frame.valid()) {
+        return;
+    }
+
+    Slot& slot = slots_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % slots_.size();
+
+    size_t row_bytes = static_cast<size_t>(frame.width) * 4;
+    slot.pixels.resize(row_bytes * frame.height);
+    for (int y = 0; y < frame.height; y++) {
+        memcpy(slot.pixels.data() + row_bytes * y, frame.row(y), row_bytes);
+    }
+
+    slot.frame_id = frame_id;
+    slot.width = frame.width;
+    slot.height = frame.height;
+    slot.timestamp_us = frame.timestamp_us;
+}
+
+bool FrameHistory::find(int64_t frame_id, RawFrame& frame) const {
+    for (const Slot& slot : slots_) {
+        if (slot.frame_id == frame_id && frame_id >= 0) {
+            frame.data = const_cast<uint8_t*>(slot.pixels.data());
+            frame.stride = slot.width * 4;
+            frame.width = slot.width;
+            frame.height = slot.height;
+            frame.timestamp_us = slot.timestamp_us;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameHistory::clear() {
+    for (Slot& slot : slots_) {
+        slot.frame_id = -1;
+    }
+    next_slot_ = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_source.h"
+
+// 原始帧历史：保存最近N帧的完整像素副本，供服务端按需拉取全分辨率帧
+// 槽位循环复用，缓冲区只在帧尺寸变大时重新分配
+class FrameHistory {
+public:
+    explicit FrameHistory(size_t capacity = 8);
+
+    // 设置保存的帧数（会清空历史）
+    void setCapacity(size_t capacity);
+    size_t capacity() const { return slots_.size(); }
+
+    // 保存帧副本，覆盖最旧的槽位
+    void store(int64_t frame_id, const RawFrame& frame);
+
+    // 查找帧，找到时frame指向内部缓冲区（在下一次store之前有效）
+    bool find(int64_t frame_id, RawFrame& frame) const;
+
+    // 清空历史
+    void clear();
+
+private:
+    struct Slot {
+        int64_t frame_id = -1;
+        int width = 0;
+        int height = 0;
+        int64_t timestamp_us = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::vector<Slot> slots_;
+    size_t next_slot_;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// 有界帧队列：一个生产者、一个消费者的环形缓冲区，满时丢弃最旧的元素，保证最新的帧总能入队
+// 槽位预先分配并循环复用，入队/出队只移动元素，不分配内存
+template <typename T>
+class FrameQueue {
+public:
+    explicit FrameQueue(size_t capacity = 2) : head_(0), size_(0), dropped_(0), woken_(false) { setCapacity(capacity); }
+
+    // 设置容量（会清空队列）
+    void setCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_.clear();
+        slots_.resize(capacity < 1 ? 1 : capacity);
+        head_ = 0;
+        size_ = 0;
+    }
+
+    // 入队，队列已满时丢弃最旧的元素并通过dropped返回，返回是否发生丢弃
+    bool push(T item, T* dropped = nullptr) {
+        bool overflow = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (size_ == slots_.size()) {
+                if (dropped) {
+                    *dropped = std::move(slots_[head_]);
+                }
+                slots_[head_] = T();
+                head_ = (head_ + 1) % slots_.size();
+                size_--;
+                dropped_++;
+                overflow = true;
+            }
+            slots_[(head_ + size_) % slots_.size()] = std::move(item);
+            size_++;
+        }
+        cv_.notify_one();
+        return overflow;
+    }
+
+    // 出队，队列为空时最多等待timeout，超时或被notify唤醒而队列仍为空时返回false
+    bool pop(T& item, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, timeout, [this] { return size_ > 0 || woken_; });
+        woken_ = false;
+        if (size_ == 0) {
+            return false;
+        }
+        item = std::move(slots_[head_]);
+        slots_[head_] = T();
+        head_ = (head_ + 1) % slots_.size();
+        size_--;
+        return true;
+    }
+
+    // 清空队列
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (T& slot : slots_) {
+            slot = T();
+        }
+        head_ = 0;
+        size_ = 0;
+    }
+
+    // 唤醒等待中的消费者（用于退出，或让消费者处理队列之外的工作）
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            woken_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // 累计丢弃的元素数
+    size_t droppedCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t head_;                    // 最旧元素的位置
+    size_t size_;                    // 元素数量
+    size_t dropped_;                 // 累计丢弃数
+    bool woken_;                     // notify后等待中的pop立即返回
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+};
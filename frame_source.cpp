@@ -0,0 +1,390 @@
+#include "frame_source.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
+namespace {
+
+// 按目标帧率等待第index帧的时间点，返回该帧的计划时间戳
+int64_t waitForFrameSlot(int64_t start_time_us, int64_t index, double fps) {
+    if (fps <= 0) {
+        return frameClockMicros();
+    }
+
+    int64_t target_us = start_time_us + static_cast<int64_t>(index * 1000000.0 / fps);
+    int64_t now_us = frameClockMicros();
+    if (target_us > now_us) {
+        std::this_thread::sleep_for(std::chrono::microseconds(target_us - now_us));
+    }
+    return target_us;
+}
+
+// 帧计数条的格子数（每帧编码帧序号，便于服务端测量延迟和丢帧）
+constexpr int COUNTER_BITS = 16;
+
+} // namespace
+
+RawFrame cropFrame(const RawFrame& frame, const FrameRect& rect) {
+    FrameRect clipped = clipRect(rect, frame.width, frame.height);
+
+    RawFrame crop = frame;
+    if (!frame.valid() || clipped.empty()) {
+        crop.data = nullptr;
+        crop.width = 0;
+        crop.height = 0;
+        return crop;
+    }
+
+    crop.data = frame.row(clipped.y) + static_cast<size_t>(clipped.x) * 4;
+    crop.width = clipped.width;
+    crop.height = clipped.height;
+    return crop;
+}
+
+// ==================== SyntheticFrameSource ====================
+
+SyntheticFrameSource::SyntheticFrameSource()
+    : width_(0), height_(0), stride_(0), fps_(0), frame_index_(0), start_time_us_(0),
+      box_x_(-1), box_y_(-1) {
+}
+
+bool SyntheticFrameSource::initialize(int width, int height, double fps) {
+    if (width <= 0 || height <= 0 || width > 7680 || height > 4320) {
+        logError_fmt("无效的合成帧尺寸: {}x{}", width, height);
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    stride_ = width * 4;
+    fps_ = fps;
+    frame_index_ = 0;
+    start_time_us_ = frameClockMicros();
+    box_x_ = -1;
+    box_y_ = -1;
+
+    background_.assign(static_cast<size_t>(stride_) * height_, 0);
+    renderBackground();
+    pixels_ = background_;
+
+    logInfo_fmt("合成帧源已初始化: {}x{} @ {} fps", width_, height_, fps_);
+    return true;
+}
+
+void SyntheticFrameSource::renderBackground() {
+    int hud_top = height_ - height_ / 10;
+
+    for (int y = 0; y < height_; y++) {
+        uint8_t* row = background_.data() + static_cast<size_t>(y) * stride_;
+        for (int x = 0; x < width_; x++) {
+            uint8_t* px = row + x * 4;
+            if (y >= hud_top) {
+                // 底部HUD条：深色带浅色分隔
+                uint8_t v = (x % 96 < 4) ? 160 : 32;
+                px[0] = v; px[1] = v; px[2] = v;
+            }
+            else if (x % 64 == 0 || y % 64 == 0) {
+                // 网格线
+                px[0] = 200; px[1] = 200; px[2] = 200;
+            }
+            else {
+                // 渐变
+                px[0] = static_cast<uint8_t>(x * 255 / width_);
+                px[1] = static_cast<uint8_t>(y * 255 / height_);
+                px[2] = static_cast<uint8_t>((x + y) * 255 / (width_ + height_));
+            }
+            px[3] = 255;
+        }
+    }
+}
+
+void SyntheticFrameSource::drawBox(int x, int y, uint32_t color) {
+    int size = std::max(16, height_ / 16);
+    for (int row = y; row < std::min(y + size, height_); row++) {
+        uint32_t* px = reinterpret_cast<uint32_t*>(pixels_.data() + static_cast<size_t>(row) * stride_);
+        std::fill(px + x, px + std::min(x + size, width_), color);
+    }
+}
+
+void SyntheticFrameSource::restoreBox(int x, int y) {
+    int size = std::max(16, height_ / 16);
+    int w = std::min(x + size, width_) - x;
+    for (int row = y; row < std::min(y + size, height_); row++) {
+        size_t offset = static_cast<size_t>(row) * stride_ + static_cast<size_t>(x) * 4;
+        memcpy(pixels_.data() + offset, background_.data() + offset, static_cast<size_t>(w) * 4);
+    }
+}
+
+bool SyntheticFrameSource::acquireFrame(RawFrame& frame) {
+    if (pixels_.empty()) {
+        return false;
+    }
+
+    int64_t timestamp = waitForFrameSlot(start_time_us_, frame_index_, fps_);
+
+    // 移动方块沿李萨如曲线运动，只重绘变化区域
+    int size = std::max(16, height_ / 16);
+    double t = frame_index_ * 0.05;
+    int x = static_cast<int>((std::sin(t) * 0.5 + 0.5) * (width_ - size));
+    int y = static_cast<int>((std::sin(t * 0.7 + 1.0) * 0.5 + 0.5) * (height_ * 9 / 10 - size));
+
+    if (box_x_ >= 0) {
+        restoreBox(box_x_, box_y_);
+    }
+    drawBox(x, y, 0xFFE04020);
+    box_x_ = x;
+    box_y_ = y;
+
+    // 左上角帧计数条
+    int cell = std::max(4, height_ / 90);
+    for (int bit = 0; bit < COUNTER_BITS && (bit + 1) * cell <= width_; bit++) {
+        uint32_t color = ((frame_index_ >> bit) & 1) ? 0xFFFFFFFF : 0xFF000000;
+        for (int row = 0; row < std::min(cell, height_); row++) {
+            uint32_t* px = reinterpret_cast<uint32_t*>(pixels_.data() + static_cast<size_t>(row) * stride_);
+            std::fill(px + bit * cell, px + (bit + 1) * cell, color);
+        }
+    }
+
+    frame.data = pixels_.data();
+    frame.stride = stride_;
+    frame.width = width_;
+    frame.height = height_;
+    frame.timestamp_us = timestamp;
+
+    frame_index_++;
+    return true;
+}
+
+// ==================== ReplayFrameSource ====================
+
+namespace {
+
+bool isRawFramePath(const std::string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".bgra") == 0;
+}
+
+// 从原始帧文件名解析尺寸，格式: xxx_宽x高.bgra
+bool parseRawFrameSize(const std::string& path, int& width, int& height) {
+    size_t underscore = path.find_last_of('_');
+    width = 0;
+    height = 0;
+    return underscore != std::string::npos &&
+        sscanf(path.c_str() + underscore + 1, "%dx%d", &width, &height) == 2 &&
+        width > 0 && height > 0;
+}
+
+} // namespace
+
+ReplayFrameSource::ReplayFrameSource()
+    : fps_(0), frame_index_(0), start_time_us_(0), width_(0), height_(0) {
+}
+
+bool ReplayFrameSource::initialize(const std::string& directory, double fps, int cache_mb) {
+    namespace fs = std::filesystem;
+
+    directory_ = directory;
+    fps_ = fps;
+    width_ = 0;
+    height_ = 0;
+    files_.clear();
+    frames_.clear();
+
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        logError_fmt("回放目录不存在: {}", directory);
+        return false;
+    }
+
+    // 收集并排序帧文件
+    std::vector<std::string> files;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".png" || ext == ".bgra") {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    // 只读取尺寸，与第一帧尺寸不同的帧在加载时拒绝
+    for (const auto& path : files) {
+        int width = 0;
+        int height = 0;
+        if (!probeFrameSize(path, width, height)) {
+            logWarn_fmt("跳过无法加载的帧文件: {}", path);
+            continue;
+        }
+        if (files_.empty()) {
+            width_ = width;
+            height_ = height;
+        }
+        else if (width != width_ || height != height_) {
+            logWarn_fmt("跳过尺寸不一致的帧文件: {} ({}x{}，第一帧为{}x{})", path, width, height, width_, height_);
+            continue;
+        }
+        files_.push_back(path);
+    }
+
+    if (files_.empty()) {
+        logError_fmt("回放目录中没有可用的帧: {}", directory);
+        return false;
+    }
+
+    // 全部帧不超过缓存上限时预先解码，回放时不再读文件
+    size_t frame_bytes = static_cast<size_t>(width_) * height_ * 4;
+    size_t total_bytes = frame_bytes * files_.size();
+    size_t cache_bytes = static_cast<size_t>(std::max(cache_mb, 0)) * 1024 * 1024;
+    if (total_bytes <= cache_bytes) {
+        frames_.reserve(files_.size());
+        for (const auto& path : files_) {
+            ReplayFrame frame;
+            if (!loadFrame(path, frame)) {
+                logError_fmt("加载帧文件失败: {}", path);
+                frames_.clear();
+                files_.clear();
+                return false;
+            }
+            frames_.push_back(std::move(frame));
+        }
+    }
+
+    frame_index_ = 0;
+    start_time_us_ = frameClockMicros();
+
+    logInfo_fmt("回放帧源: {} 帧 {}x{} ({:.1f} MB，{})，目标帧率: {}",
+        files_.size(), width_, height_, total_bytes / (1024.0 * 1024.0),
+        isCached() ? "已预加载" : "超出缓存上限，逐帧加载", fps_);
+    return true;
+}
+
+bool ReplayFrameSource::probeFrameSize(const std::string& path, int& width, int& height) {
+    if (isRawFramePath(path)) {
+        if (!parseRawFrameSize(path, width, height)) {
+            logWarn_fmt("无法从文件名解析帧尺寸: {}", path);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef HAVE_LIBPNG
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path.c_str())) {
+        logWarn_fmt("读取PNG失败: {}: {}", path, image.message);
+        return false;
+    }
+    width = static_cast<int>(image.width);
+    height = static_cast<int>(image.height);
+    png_image_free(&image);
+    return true;
+#else
+    logWarn_fmt("未启用libpng，无法加载PNG帧: {}", path);
+    return false;
+#endif
+}
+
+bool ReplayFrameSource::loadFrame(const std::string& path, ReplayFrame& frame) {
+    bool ok = isRawFramePath(path) ? loadRawFrame(path, frame) : loadPngFrame(path, frame);
+    if (ok && (frame.width != width_ || frame.height != height_)) {
+        logWarn_fmt("帧尺寸与第一帧不一致: {}", path);
+        return false;
+    }
+    return ok;
+}
+
+bool ReplayFrameSource::loadRawFrame(const std::string& path, ReplayFrame& frame) {
+    int width = 0;
+    int height = 0;
+    if (!parseRawFrameSize(path, width, height)) {
+        logWarn_fmt("无法从文件名解析帧尺寸: {}", path);
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(width) * height * 4;
+    frame.pixels.resize(size);
+    file.read(reinterpret_cast<char*>(frame.pixels.data()), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(file.gcount()) != size) {
+        logWarn_fmt("原始帧文件大小不匹配: {}", path);
+        return false;
+    }
+
+    frame.width = width;
+    frame.height = height;
+    return true;
+}
+
+bool ReplayFrameSource::loadPngFrame(const std::string& path, ReplayFrame& frame) {
+#ifdef HAVE_LIBPNG
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+
+    if (!png_image_begin_read_from_file(&image, path.c_str())) {
+        logWarn_fmt("读取PNG失败: {}: {}", path, image.message);
+        return false;
+    }
+
+    image.format = PNG_FORMAT_BGRA;
+    frame.pixels.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, frame.pixels.data(), 0, nullptr)) {
+        logWarn_fmt("解码PNG失败: {}: {}", path, image.message);
+        png_image_free(&image);
+        return false;
+    }
+
+    frame.width = static_cast<int>(image.width);
+    frame.height = static_cast<int>(image.height);
+    return true;
+#else
+    (void)frame;
+    logWarn_fmt("未启用libpng，无法加载PNG帧: {}", path);
+    return false;
+#endif
+}
+
+bool ReplayFrameSource::acquireFrame(RawFrame& frame) {
+    if (files_.empty()) {
+        return false;
+    }
+
+    int64_t timestamp = waitForFrameSlot(start_time_us_, frame_index_, fps_);
+
+    // 帧视图总是指向工作缓冲区（在下一次acquireFrame之前有效）：
+    // 使用方会在帧上绘制遮罩和光标，预加载的帧保持只读，每轮回放的内容相同
+    size_t index = static_cast<size_t>(frame_index_ % files_.size());
+    if (!frames_.empty()) {
+        const ReplayFrame& cached = frames_[index];
+        stream_frame_.pixels.assign(cached.pixels.begin(), cached.pixels.end());
+        stream_frame_.width = cached.width;
+        stream_frame_.height = cached.height;
+    }
+    else if (!loadFrame(files_[index], stream_frame_)) {
+        logError_fmt("加载帧文件失败: {}", files_[index]);
+        return false;
+    }
+
+    frame.data = stream_frame_.pixels.data();
+    frame.stride = stream_frame_.width * 4;
+    frame.width = stream_frame_.width;
+    frame.height = stream_frame_.height;
+    frame.timestamp_us = timestamp;
+
+    frame_index_++;
+    return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// 平台无关的矩形（像素坐标）
+struct FrameRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+};
+
+// 原始BGRA帧视图，数据由帧源持有，在下一次acquireFrame之前有效
+// 使用方可以原地修改像素（如遮罩填充），帧源下一次产生帧时会覆盖或保留这些修改
+struct RawFrame {
+    uint8_t* data = nullptr;   // 首行像素地址（BGRA，每像素4字节）
+    int stride = 0;            // 行跨度（字节）
+    int width = 0;             // 宽度
+    int height = 0;            // 高度
+    int64_t timestamp_us = 0;  // 采集时间戳（微秒，steady_clock）
+
+    bool valid() const { return data != nullptr && width > 0 && height > 0; }
+    uint8_t* row(int y) const { return data + static_cast<size_t>(y) * stride; }
+};
+
+// 获取帧时间戳（微秒）
+inline int64_t frameClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 将矩形裁剪到width×height范围内
+inline FrameRect clipRect(const FrameRect& rect, int width, int height) {
+    int left = rect.x < 0 ? 0 : rect.x;
+    int top = rect.y < 0 ? 0 : rect.y;
+    int right = rect.x + rect.width > width ? width : rect.x + rect.width;
+    int bottom = rect.y + rect.height > height ? height : rect.y + rect.height;
+    if (right <= left || bottom <= top) {
+        return { left, top, 0, 0 };
+    }
+    return { left, top, right - left, bottom - top };
+}
+
+// 截取帧的子区域视图（不复制像素），区域会被裁剪到帧范围内
+RawFrame cropFrame(const RawFrame& frame, const FrameRect& rect);
+
+// 帧源接口：产生原始BGRA帧，供变化检测、编码和发送使用
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // 获取下一帧，成功时frame指向帧源内部缓冲区
+    virtual bool acquireFrame(RawFrame& frame) = 0;
+
+    // 帧源是否仍然可用
+    virtual bool isValid() const = 0;
+
+    // 帧源在屏幕上的位置（合成源为(0,0,宽,高)）
+    virtual FrameRect getSourceRect() const = 0;
+
+    // 帧源名称（用于日志）
+    virtual const char* getName() const = 0;
+};
+
+// 合成帧源：生成动画测试图案，用于无窗口环境下的性能测试
+class SyntheticFrameSource : public FrameSource {
+public:
+    SyntheticFrameSource();
+
+    // 初始化（fps<=0表示不限速）
+    bool initialize(int width, int height, double fps);
+
+    bool acquireFrame(RawFrame& frame) override;
+    bool isValid() const override { return !pixels_.empty(); }
+    FrameRect getSourceRect() const override { return { 0, 0, width_, height_ }; }
+    const char* getName() const override { return "synthetic"; }
+
+private:
+    // 绘制静态背景（渐变+网格+HUD条）
+    void renderBackground();
+
+    // 绘制/擦除移动方块
+    void drawBox(int x, int y, uint32_t color);
+    void restoreBox(int x, int y);
+
+    int width_;
+    int height_;
+    int stride_;
+    double fps_;
+    int64_t frame_index_;
+    int64_t start_time_us_;
+    int box_x_;                     // 上一帧方块位置
+    int box_y_;
+    std::vector<uint8_t> background_;  // 静态背景
+    std::vector<uint8_t> pixels_;      // 当前帧
+};
+
+// 回放帧源：按目标帧率循环播放目录中的帧文件
+// 支持 *.png（需要libpng）和 *_宽x高.bgra 原始帧文件，所有帧的尺寸必须与第一帧相同
+// 全部帧解码后不超过缓存上限时预先加载到内存，否则每次取帧时从文件加载（解码时间计入取帧耗时）
+class ReplayFrameSource : public FrameSource {
+public:
+    ReplayFrameSource();
+
+    // 扫描目录中的帧（按文件名排序），fps<=0表示不限速，cache_mb为预加载的内存上限（MB）
+    bool initialize(const std::string& directory, double fps, int cache_mb = 512);
+
+    bool acquireFrame(RawFrame& frame) override;
+    bool isValid() const override { return !files_.empty(); }
+    FrameRect getSourceRect() const override { return { 0, 0, width_, height_ }; }
+    const char* getName() const override { return "replay"; }
+
+    size_t frameCount() const { return files_.size(); }
+
+    // 帧是否已全部预加载
+    bool isCached() const { return !frames_.empty(); }
+
+private:
+    struct ReplayFrame {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+    };
+
+    // 读取帧尺寸（原始帧从文件名解析，PNG只读文件头）
+    bool probeFrameSize(const std::string& path, int& width, int& height);
+
+    // 加载帧文件（按扩展名选择格式），frame的缓冲区容量可复用
+    bool loadFrame(const std::string& path, ReplayFrame& frame);
+
+    // 加载原始BGRA帧（尺寸从文件名中解析）
+    bool loadRawFrame(const std::string& path, ReplayFrame& frame);
+
+    // 加载PNG帧并转换为BGRA
+    bool loadPngFrame(const std::string& path, ReplayFrame& frame);
+
+    std::string directory_;
+    double fps_;
+    int64_t frame_index_;
+    int64_t start_time_us_;
+    int width_;                        // 帧尺寸（来自第一帧）
+    int height_;
+    std::vector<std::string> files_;   // 尺寸一致的帧文件
+    std::vector<ReplayFrame> frames_;  // 预加载的帧（超出缓存上限时为空）
+    ReplayFrame stream_frame_;         // 取帧的工作缓冲区（预加载时从缓存复制，否则从文件加载）
+};
@@ -0,0 +1,149 @@
+#include <windows.h>
+#include <objbase.h> // 提供PROPID定义
+
+// 如果PROPID仍未定义，手动定义它
+#ifndef PROPID
+typedef ULONG PROPID;
+#endif
+
+#include <gdiplus.h>
+#include <objidl.h>
+#include "gdiplus_encoder.h"
+#include "pixel_convert.h"
+#include "LogWrapper.h"
+
+using namespace Gdiplus;
+
+namespace {
+
+// 查找指定格式的编码器CLSID
+bool findEncoderClsid(const WCHAR* format, CLSID* clsid) {
+    UINT num = 0;          // 编码器数量
+    UINT size = 0;         // 编码器信息大小
+    GetImageEncodersSize(&num, &size);
+    if (size == 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(size);
+    ImageCodecInfo* codecs = reinterpret_cast<ImageCodecInfo*>(buffer.data());
+    GetImageEncoders(num, size, codecs);
+
+    for (UINT i = 0; i < num; ++i) {
+        if (wcscmp(codecs[i].MimeType, format) == 0) {
+            *clsid = codecs[i].Clsid;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+GdiplusJpegEncoder::GdiplusJpegEncoder()
+    : has_clsid_(false), stream_(nullptr) {
+    has_clsid_ = findEncoderClsid(L"image/jpeg", &clsid_);
+    if (!has_clsid_) {
+        logError("获取JPEG编码器失败");
+    }
+
+    HRESULT hr = CreateStreamOnHGlobal(NULL, TRUE, &stream_);
+    if (FAILED(hr)) {
+        logError_fmt("创建流失败: 0x{:X}", hr);
+        stream_ = nullptr;
+    }
+}
+
+GdiplusJpegEncoder::~GdiplusJpegEncoder() {
+    if (stream_) {
+        stream_->Release();
+    }
+}
+
+bool GdiplusJpegEncoder::encode(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!has_clsid_ || !stream_) {
+        return false;
+    }
+
+    Bitmap* bmp = nullptr;
+    if (luma) {
+        // 亮度模式：先转为8位灰度，以灰度调色板的索引位图编码
+        int luma_stride = (frame.width + 3) & ~3;
+        luma_.resize(static_cast<size_t>(luma_stride) * frame.height);
+        convertToLuma(frame, luma_.data(), luma_stride);
+
+        bmp = new Bitmap(frame.width, frame.height, luma_stride, PixelFormat8bppIndexed, luma_.data());
+        if (bmp && bmp->GetLastStatus() == Ok) {
+            palette_.resize(sizeof(ColorPalette) + 255 * sizeof(ARGB));
+            ColorPalette* palette = reinterpret_cast<ColorPalette*>(palette_.data());
+            palette->Flags = PaletteFlagsGrayScale;
+            palette->Count = 256;
+            for (UINT i = 0; i < 256; i++) {
+                palette->Entries[i] = Color::MakeARGB(255, static_cast<BYTE>(i), static_cast<BYTE>(i), static_cast<BYTE>(i));
+            }
+            bmp->SetPalette(palette);
+        }
+    }
+    else {
+        // 直接包装原始像素创建Bitmap对象（不复制像素）
+        bmp = new Bitmap(frame.width, frame.height, frame.stride, PixelFormat32bppRGB, frame.data);
+    }
+    if (!bmp) {
+        logError("创建GDI+ Bitmap失败");
+        return false;
+    }
+
+    // 检查位图是否有效
+    if (bmp->GetLastStatus() != Ok) {
+        logError("GDI+ Bitmap无效");
+        delete bmp;
+        return false;
+    }
+
+    // 复用内存流：回到开头并清空上一帧的内容
+    LARGE_INTEGER zero = { 0 };
+    ULARGE_INTEGER empty = { 0 };
+    stream_->Seek(zero, STREAM_SEEK_SET, NULL);
+    stream_->SetSize(empty);
+
+    // 设置编码参数
+    EncoderParameters encoderParams;
+    encoderParams.Count = 1;
+    encoderParams.Parameter[0].Guid = EncoderQuality;
+    encoderParams.Parameter[0].Type = EncoderParameterValueTypeLong;
+    encoderParams.Parameter[0].NumberOfValues = 1;
+    ULONG qualityValue = quality;
+    encoderParams.Parameter[0].Value = &qualityValue;
+
+    // 保存为JPEG
+    Status status = bmp->Save(stream_, &clsid_, &encoderParams);
+    delete bmp;
+
+    if (status != Ok) {
+        logError_fmt("保存JPEG失败: {}", static_cast<int>(status));
+        return false;
+    }
+
+    // 获取数据大小
+    STATSTG stat;
+    HRESULT hr = stream_->Stat(&stat, STATFLAG_NONAME);
+    if (FAILED(hr)) {
+        logError_fmt("获取流状态失败: 0x{:X}", hr);
+        return false;
+    }
+    ULONG size = stat.cbSize.LowPart;
+
+    // 写入输出缓冲区（容量足够时不重新分配）
+    out.resize(size);
+    stream_->Seek(zero, STREAM_SEEK_SET, NULL);
+    ULONG bytesRead = 0;
+    hr = stream_->Read(out.data(), size, &bytesRead);
+    if (FAILED(hr) || bytesRead != size) {
+        logError_fmt("读取流数据失败: 0x{:X}", hr);
+        out.clear();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <windows.h>
+#include "image_encoder.h"
+
+// GDI+编码器：包装源像素为Bitmap后保存到内存流，再复制到输出缓冲区
+// JPEG编码器CLSID和内存流在构造时创建并跨帧复用；灰度模式先转为8位亮度再以灰度调色板编码
+class GdiplusJpegEncoder : public ImageEncoder {
+public:
+    GdiplusJpegEncoder();
+    ~GdiplusJpegEncoder() override;
+
+    bool encode(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) override;
+    const char* getName() const override { return "gdiplus"; }
+
+private:
+    bool has_clsid_;                 // 是否找到JPEG编码器
+    CLSID clsid_;                    // JPEG编码器CLSID
+    IStream* stream_;                // 复用的内存流
+    std::vector<uint8_t> luma_;      // 灰度模式的亮度缓冲区
+    std::vector<uint8_t> palette_;   // 灰度调色板
+};
@@ -0,0 +1,30 @@
+#include "image_encoder.h"
+
+#ifdef HAVE_LIBJPEG_TURBO
+#include "jpeg_turbo_encoder.h"
+#endif
+#ifdef _WIN32
+#include "gdiplus_encoder.h"
+#endif
+
+std::unique_ptr<ImageEncoder> createImageEncoder(const std::string& name) {
+#ifdef HAVE_LIBJPEG_TURBO
+    if (name == "turbojpeg") {
+        return std::make_unique<TurboJpegEncoder>();
+    }
+#endif
+#ifdef _WIN32
+    if (name == "gdiplus") {
+        return std::make_unique<GdiplusJpegEncoder>();
+    }
+#endif
+    return nullptr;
+}
+
+const char* defaultImageEncoderName() {
+#ifdef HAVE_LIBJPEG_TURBO
+    return "turbojpeg";
+#else
+    return "gdiplus";
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "frame_source.h"
+
+// 图像编码器接口：把带行跨度的BGRA帧视图直接编码为JPEG，写入调用方提供的缓冲区
+// 输出缓冲区的容量跨帧复用；编码器内部保留压缩状态，同一实例不能由多个线程同时使用
+class ImageEncoder {
+public:
+    virtual ~ImageEncoder() = default;
+
+    // 编码frame（luma为真时编码为单通道灰度JPEG），out被覆盖，失败时为空
+    virtual bool encode(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) = 0;
+
+    // 条带编码：与encode相同，但每个MCU行后插入重启标记，供并行编码的条带拼接为一个JPEG
+    // 不支持时返回false（默认）
+    virtual bool encodeStripe(const RawFrame& /*frame*/, int /*quality*/, bool /*luma*/, std::vector<uint8_t>& out) {
+        out.clear();
+        return false;
+    }
+
+    // 条带高度须为此值（MCU高度）的整数倍，0表示不支持条带编码
+    virtual int stripeAlignment(bool /*luma*/) const { return 0; }
+
+    // 编码器名称（用于配置和日志）
+    virtual const char* getName() const = 0;
+};
+
+// 按名称创建编码器："turbojpeg"（libjpeg-turbo）或"gdiplus"，未编译进来的编码器返回nullptr
+std::unique_ptr<ImageEncoder> createImageEncoder(const std::string& name);
+
+// 默认编码器名称：有libjpeg-turbo时优先使用
+const char* defaultImageEncoderName();
@@ -0,0 +1,191 @@
+#include "image_resize.h"
+#include "simd_util.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 计算每个目标像素对应的源区间[begin, end)
+void computeSpans(int src_size, int dst_size, std::vector<int>& begins, std::vector<int>& ends) {
+    begins.resize(dst_size);
+    ends.resize(dst_size);
+    for (int i = 0; i < dst_size; i++) {
+        int begin = static_cast<int>(static_cast<int64_t>(i) * src_size / dst_size);
+        int end = static_cast<int>(static_cast<int64_t>(i + 1) * src_size / dst_size);
+        begins[i] = begin;
+        ends[i] = std::max(end, begin + 1);
+    }
+}
+
+// 将一行源像素累加到sums（first为真时直接写入）
+void accumulateRowScalar(const uint8_t* row, uint32_t* sums, int count, bool first) {
+    if (first) {
+        for (int i = 0; i < count; i++) sums[i] = row[i];
+    }
+    else {
+        for (int i = 0; i < count; i++) sums[i] += row[i];
+    }
+}
+
+#ifdef FRAME_SIMD_X86
+
+// SSE2：每次处理16字节，扩展为4组32位累加
+void accumulateRowSse2(const uint8_t* row, uint32_t* sums, int count, bool first) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+        __m128i v0 = _mm_unpacklo_epi16(lo16, zero);
+        __m128i v1 = _mm_unpackhi_epi16(lo16, zero);
+        __m128i v2 = _mm_unpacklo_epi16(hi16, zero);
+        __m128i v3 = _mm_unpackhi_epi16(hi16, zero);
+
+        __m128i* out = reinterpret_cast<__m128i*>(sums + i);
+        if (!first) {
+            v0 = _mm_add_epi32(v0, _mm_loadu_si128(out + 0));
+            v1 = _mm_add_epi32(v1, _mm_loadu_si128(out + 1));
+            v2 = _mm_add_epi32(v2, _mm_loadu_si128(out + 2));
+            v3 = _mm_add_epi32(v3, _mm_loadu_si128(out + 3));
+        }
+        _mm_storeu_si128(out + 0, v0);
+        _mm_storeu_si128(out + 1, v1);
+        _mm_storeu_si128(out + 2, v2);
+        _mm_storeu_si128(out + 3, v3);
+    }
+    accumulateRowScalar(row + i, sums + i, count - i, first);
+}
+
+// AVX2：每次处理16字节，扩展为2组8个32位累加
+SIMD_TARGET_AVX2
+void accumulateRowAvx2(const uint8_t* row, uint32_t* sums, int count, bool first) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m256i v0 = _mm256_cvtepu8_epi32(bytes);
+        __m256i v1 = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+
+        __m256i* out = reinterpret_cast<__m256i*>(sums + i);
+        if (!first) {
+            v0 = _mm256_add_epi32(v0, _mm256_loadu_si256(out + 0));
+            v1 = _mm256_add_epi32(v1, _mm256_loadu_si256(out + 1));
+        }
+        _mm256_storeu_si256(out + 0, v0);
+        _mm256_storeu_si256(out + 1, v1);
+    }
+    accumulateRowScalar(row + i, sums + i, count - i, first);
+}
+
+// SSE2：横向累加区间内的像素（每像素4个32位通道）并求平均
+void averageRowSse2(const uint32_t* sums, const int* x_begin, const int* x_end, int dst_width,
+                    int rows, uint8_t* out) {
+    for (int dx = 0; dx < dst_width; dx++) {
+        const __m128i* px = reinterpret_cast<const __m128i*>(sums) + x_begin[dx];
+        const __m128i* end = reinterpret_cast<const __m128i*>(sums) + x_end[dx];
+        __m128i sum = _mm_loadu_si128(px++);
+        while (px < end) {
+            sum = _mm_add_epi32(sum, _mm_loadu_si128(px++));
+        }
+
+        float inv_count = 1.0f / static_cast<float>(rows * (x_end[dx] - x_begin[dx]));
+        __m128 average = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(inv_count)),
+                                    _mm_set1_ps(0.5f));
+        __m128i result = _mm_cvttps_epi32(average);
+        result = _mm_packs_epi32(result, result);
+        result = _mm_packus_epi16(result, result);
+        int32_t pixel = _mm_cvtsi128_si32(result);
+        memcpy(out + dx * 4, &pixel, 4);
+    }
+}
+
+#else
+
+void averageRowScalar(const uint32_t* sums, const int* x_begin, const int* x_end, int dst_width,
+                      int rows, uint8_t* out) {
+    for (int dx = 0; dx < dst_width; dx++) {
+        uint32_t sum[4] = { 0, 0, 0, 0 };
+        for (int sx = x_begin[dx]; sx < x_end[dx]; sx++) {
+            const uint32_t* px = sums + static_cast<size_t>(sx) * 4;
+            sum[0] += px[0];
+            sum[1] += px[1];
+            sum[2] += px[2];
+            sum[3] += px[3];
+        }
+
+        uint32_t count = static_cast<uint32_t>(rows * (x_end[dx] - x_begin[dx]));
+        for (int c = 0; c < 4; c++) {
+            out[dx * 4 + c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+FrameResizer::FrameResizer()
+    : src_width_(0), src_height_(0), dst_width_(0), dst_height_(0) {
+}
+
+void FrameResizer::prepare(int src_width, int src_height, int dst_width, int dst_height) {
+    if (src_width == src_width_ && src_height == src_height_ &&
+        dst_width == dst_width_ && dst_height == dst_height_) {
+        return;
+    }
+
+    computeSpans(src_width, dst_width, x_begin_, x_end_);
+    computeSpans(src_height, dst_height, y_begin_, y_end_);
+    column_sums_.resize(static_cast<size_t>(src_width) * 4);
+    pixels_.resize(static_cast<size_t>(dst_width) * 4 * dst_height);
+
+    src_width_ = src_width;
+    src_height_ = src_height;
+    dst_width_ = dst_width;
+    dst_height_ = dst_height;
+}
+
+RawFrame FrameResizer::resize(const RawFrame& src, int dst_width, int dst_height) {
+    RawFrame dst;
+    if (!src.valid() || dst_width <= 0 || dst_height <= 0) {
+        logError_fmt("无效的缩放参数: {}x{} -> {}x{}", src.width, src.height, dst_width, dst_height);
+        return dst;
+    }
+
+    prepare(src.width, src.height, dst_width, dst_height);
+
+    size_t dst_stride = static_cast<size_t>(dst_width) * 4;
+    int row_bytes = src.width * 4;
+
+#ifdef FRAME_SIMD_X86
+    auto accumulateRow = cpuHasAvx2() ? accumulateRowAvx2 : accumulateRowSse2;
+#endif
+
+    for (int dy = 0; dy < dst_height; dy++) {
+        // 先纵向累加区间内的源行
+        for (int sy = y_begin_[dy]; sy < y_end_[dy]; sy++) {
+#ifdef FRAME_SIMD_X86
+            accumulateRow(src.row(sy), column_sums_.data(), row_bytes, sy == y_begin_[dy]);
+#else
+            accumulateRowScalar(src.row(sy), column_sums_.data(), row_bytes, sy == y_begin_[dy]);
+#endif
+        }
+
+        // 再横向累加并求平均
+        int rows = y_end_[dy] - y_begin_[dy];
+        uint8_t* out = pixels_.data() + dst_stride * dy;
+#ifdef FRAME_SIMD_X86
+        averageRowSse2(column_sums_.data(), x_begin_.data(), x_end_.data(), dst_width, rows, out);
+#else
+        averageRowScalar(column_sums_.data(), x_begin_.data(), x_end_.data(), dst_width, rows, out);
+#endif
+    }
+
+    dst.data = pixels_.data();
+    dst.stride = static_cast<int>(dst_stride);
+    dst.width = dst_width;
+    dst.height = dst_height;
+    dst.timestamp_us = src.timestamp_us;
+    return dst;
+}
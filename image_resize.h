@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_source.h"
+
+// 帧缩放器：区域平均缩小BGRA帧（放大时退化为最近邻）
+// 纵向累加使用AVX2/SSE2，横向求平均使用SSE2，非x86平台使用标量实现
+// 源/目标尺寸不变时复用区间表和缓冲区
+class FrameResizer {
+public:
+    FrameResizer();
+
+    // 缩放src到dst_width×dst_height，返回指向内部缓冲区的帧视图（下一次resize前有效）
+    // 失败时返回无效帧
+    RawFrame resize(const RawFrame& src, int dst_width, int dst_height);
+
+private:
+    // 计算源/目标尺寸对应的区间表
+    void prepare(int src_width, int src_height, int dst_width, int dst_height);
+
+    int src_width_;
+    int src_height_;
+    int dst_width_;
+    int dst_height_;
+    std::vector<int> x_begin_;       // 每个目标列对应的源列区间[begin, end)
+    std::vector<int> x_end_;
+    std::vector<int> y_begin_;       // 每个目标行对应的源行区间[begin, end)
+    std::vector<int> y_end_;
+    std::vector<uint32_t> column_sums_; // 纵向累加结果（每个源像素4个通道）
+    std::vector<uint8_t> pixels_;    // 输出缓冲区
+};
+
+// 按比例计算缩放后的尺寸（至少1像素）
+inline void scaledSize(int width, int height, double scale, int& out_width, int& out_height) {
+    out_width = static_cast<int>(width * scale + 0.5);
+    out_height = static_cast<int>(height * scale + 0.5);
+    if (out_width < 1) out_width = 1;
+    if (out_height < 1) out_height = 1;
+}
+
+// 计算保持宽高比、放入max_width×max_height内的尺寸（不放大；max<=0表示不限制）
+inline void fitSize(int width, int height, int max_width, int max_height, int& out_width, int& out_height) {
+    double scale = 1.0;
+    if (max_width > 0 && width > max_width) {
+        scale = static_cast<double>(max_width) / width;
+    }
+    if (max_height > 0 && height * scale > max_height) {
+        scale = static_cast<double>(max_height) / height;
+    }
+    if (scale >= 1.0) {
+        out_width = width;
+        out_height = height;
+        return;
+    }
+    scaledSize(width, height, scale, out_width, out_height);
+    if (max_width > 0 && out_width > max_width) out_width = max_width;
+    if (max_height > 0 && out_height > max_height) out_height = max_height;
+}
+
+// 将源帧中的矩形映射为缩放后帧中覆盖它的最小矩形
+inline FrameRect scaleRect(const FrameRect& rect, int src_width, int src_height, int dst_width, int dst_height) {
+    if (src_width == dst_width && src_height == dst_height) {
+        return rect;
+    }
+    int left = static_cast<int>(static_cast<int64_t>(rect.x) * dst_width / src_width);
+    int top = static_cast<int>(static_cast<int64_t>(rect.y) * dst_height / src_height);
+    int right = static_cast<int>((static_cast<int64_t>(rect.x + rect.width) * dst_width + src_width - 1) / src_width);
+    int bottom = static_cast<int>((static_cast<int64_t>(rect.y + rect.height) * dst_height + src_height - 1) / src_height);
+    return clipRect({ left, top, right - left, bottom - top }, dst_width, dst_height);
+}
@@ -185,8 +185,7 @@ void InputSimulator::simulateMouseMove(int x, int y, bool smooth) {
     }
 
     // 更新当前鼠标位置
-    current_mouse_pos_.x = x;
-    current_mouse_pos_.y = y;
+    updateMousePosition(x, y);
 }
 
 void InputSimulator::simulateMouseClick(int x, int y, bool right_button) {
@@ -266,8 +265,18 @@ void InputSimulator::simulateMouseDrag(int start_x, int start_y, int end_x, int
     sendInputEvent(input);
 
     // 更新当前鼠标位置
-    current_mouse_pos_.x = end_x;
-    current_mouse_pos_.y = end_y;
+    updateMousePosition(end_x, end_y);
+}
+
+void InputSimulator::updateMousePosition(int x, int y) {
+    std::lock_guard<std::mutex> lock(mouse_mutex_);
+    current_mouse_pos_.x = x;
+    current_mouse_pos_.y = y;
+}
+
+POINT InputSimulator::getMousePosition() const {
+    std::lock_guard<std::mutex> lock(mouse_mutex_);
+    return current_mouse_pos_;
 }
 
 void InputSimulator::simulateKeyPress(const std::string& key) {
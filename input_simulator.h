@@ -5,6 +5,7 @@
 #include <vector>
 #include <chrono>
 #include <unordered_map>
+#include <mutex>
 
 // Ϊģṹ
 struct HumanParameters {
@@ -46,6 +47,9 @@ public:
     // 
     int addHumanJitter(int value, int max_jitter);
 
+    // ȡģλãĻ꣬ɴ̵߳ã
+    POINT getMousePosition() const;
+
     // ͷа
     void releaseAllKeys();
 
@@ -60,12 +64,14 @@ private:
     void sendKeyDown(UINT virtual_key);
     void sendKeyUp(UINT virtual_key);
     void interpolateMouseMovement(int start_x, int start_y, int end_x, int end_y);
+    void updateMousePosition(int x, int y);
 
     // Ϊģ
     void initializeHumanParameters();
     void updateHumanParameters();
 
     POINT current_mouse_pos_;
+    mutable std::mutex mouse_mutex_;  // current_mouse_pos_̶߳ȡ
     bool initialized_ = false;
 
     // ״̬
@@ -0,0 +1,133 @@
+#include "jpeg_stripes.h"
+#include <cstring>
+
+namespace {
+
+// JPEG标记
+constexpr uint8_t MARKER_SOI = 0xD8;
+constexpr uint8_t MARKER_EOI = 0xD9;
+constexpr uint8_t MARKER_SOS = 0xDA;
+constexpr uint8_t MARKER_DRI = 0xDD;
+constexpr uint8_t MARKER_RST0 = 0xD0;
+constexpr uint8_t MARKER_RST7 = 0xD7;
+
+// 一个条带的布局
+struct StripeLayout {
+    size_t height_offset = 0;        // SOF中图像高度字段的位置
+    size_t scan_begin = 0;           // 熵编码数据起始（SOS段之后）
+    size_t scan_end = 0;             // 熵编码数据结束（EOI之前）
+    bool has_restart = false;        // 文件头中有DRI段
+};
+
+bool isStartOfFrame(uint8_t marker) {
+    // SOF0~SOF15，排除DHT(C4)、JPG(C8)、DAC(CC)
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+// 解析文件头，直到第一个SOS段
+bool parseStripe(const std::vector<uint8_t>& data, StripeLayout& layout) {
+    size_t size = data.size();
+    if (size < 4 || data[0] != 0xFF || data[1] != MARKER_SOI ||
+        data[size - 2] != 0xFF || data[size - 1] != MARKER_EOI) {
+        return false;
+    }
+
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > size) {
+            return false;
+        }
+
+        if (isStartOfFrame(marker)) {
+            // 段内容：精度(1) 高度(2) 宽度(2) ...
+            if (length < 7) {
+                return false;
+            }
+            layout.height_offset = pos + 5;
+        }
+        else if (marker == MARKER_DRI) {
+            layout.has_restart = length >= 4 && (data[pos + 4] != 0 || data[pos + 5] != 0);
+        }
+
+        pos += 2 + length;
+        if (marker == MARKER_SOS) {
+            layout.scan_begin = pos;
+            layout.scan_end = size - 2;
+            return layout.height_offset != 0 && layout.scan_begin <= layout.scan_end;
+        }
+    }
+    return false;
+}
+
+// 复制熵编码数据，按全局序号重新编号其中的重启标记
+// 数据中的0xFF都经过填充（后跟0x00），只有重启标记后跟D0~D7
+void appendScan(const uint8_t* begin, const uint8_t* end, int& restart_index, std::vector<uint8_t>& out) {
+    const uint8_t* pos = begin;
+    while (pos < end) {
+        const uint8_t* ff = static_cast<const uint8_t*>(std::memchr(pos, 0xFF, end - pos));
+        if (!ff || ff + 1 >= end) {
+            out.insert(out.end(), pos, end);
+            return;
+        }
+
+        out.insert(out.end(), pos, ff + 1);
+        uint8_t next = ff[1];
+        if (next >= MARKER_RST0 && next <= MARKER_RST7) {
+            next = static_cast<uint8_t>(MARKER_RST0 + (restart_index++ & 7));
+        }
+        out.push_back(next);
+        pos = ff + 2;
+    }
+}
+
+} // namespace
+
+bool mergeJpegStripes(const std::vector<std::vector<uint8_t>>& stripes, int height, std::vector<uint8_t>& out) {
+    out.clear();
+    if (stripes.empty() || height <= 0 || height > 0xFFFF) {
+        return false;
+    }
+
+    StripeLayout first;
+    if (!parseStripe(stripes[0], first) || (stripes.size() > 1 && !first.has_restart)) {
+        return false;
+    }
+
+    size_t total = stripes[0].size();
+    for (size_t i = 1; i < stripes.size(); i++) {
+        total += stripes[i].size() + 2;
+    }
+    out.reserve(total);
+
+    // 文件头：第一个条带的各段，高度改为总高度
+    out.insert(out.end(), stripes[0].begin(), stripes[0].begin() + first.scan_begin);
+    out[first.height_offset] = static_cast<uint8_t>(height >> 8);
+    out[first.height_offset + 1] = static_cast<uint8_t>(height & 0xFF);
+
+    int restart_index = 0;
+    for (size_t i = 0; i < stripes.size(); i++) {
+        StripeLayout layout = first;
+        if (i > 0) {
+            if (!parseStripe(stripes[i], layout)) {
+                out.clear();
+                return false;
+            }
+
+            // 条带之间的重启标记
+            out.push_back(0xFF);
+            out.push_back(static_cast<uint8_t>(MARKER_RST0 + (restart_index++ & 7)));
+        }
+
+        const uint8_t* data = stripes[i].data();
+        appendScan(data + layout.scan_begin, data + layout.scan_end, restart_index, out);
+    }
+
+    out.push_back(0xFF);
+    out.push_back(MARKER_EOI);
+    return true;
+}
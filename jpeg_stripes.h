@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 条带并行编码的拼接：各水平条带作为独立JPEG编码（相同宽度、质量和量化/霍夫曼表，每个MCU行后有重启标记），
+// 取第一个条带的文件头并改写图像高度，依次连接各条带的熵编码数据，在条带之间补充重启标记并重新编号RST0~RST7
+// 重启标记处DC预测复位，因此拼接结果是任何标准解码器都能解码的单个JPEG
+// stripes除最后一个外高度须为MCU高度的整数倍，height为拼接后的总高度；格式不符时返回false
+bool mergeJpegStripes(const std::vector<std::vector<uint8_t>>& stripes, int height, std::vector<uint8_t>& out);
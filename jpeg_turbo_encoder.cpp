@@ -0,0 +1,147 @@
+#include "jpeg_turbo_encoder.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+
+#include <jpeglib.h>
+
+namespace {
+
+// 输出缓冲区的初始大小（之后复用上一帧的容量）
+constexpr size_t INITIAL_OUTPUT_SIZE = 64 * 1024;
+
+// libjpeg默认的错误处理会直接退出进程，改为跳回encode
+struct ErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void onJpegError(j_common_ptr cinfo) {
+    ErrorManager* error = reinterpret_cast<ErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, error->message);
+    longjmp(error->jump, 1);
+}
+
+} // namespace
+
+struct TurboJpegEncoder::JpegState {
+    jpeg_compress_struct cinfo;
+    ErrorManager error;
+    jpeg_destination_mgr destination;
+    std::vector<JSAMPROW> rows;            // 各行像素指针（按帧高度复用）
+    bool created = false;
+};
+
+namespace {
+
+// 目标管理器：直接写入输出vector（client_data），空间不足时翻倍
+std::vector<uint8_t>& outputOf(j_compress_ptr cinfo) {
+    return *static_cast<std::vector<uint8_t>*>(cinfo->client_data);
+}
+
+void initDestination(j_compress_ptr cinfo) {
+    std::vector<uint8_t>& out = outputOf(cinfo);
+    out.resize(std::max(out.capacity(), INITIAL_OUTPUT_SIZE));
+    cinfo->dest->next_output_byte = out.data();
+    cinfo->dest->free_in_buffer = out.size();
+}
+
+boolean emptyOutputBuffer(j_compress_ptr cinfo) {
+    // 被调用时缓冲区已全部写满
+    std::vector<uint8_t>& out = outputOf(cinfo);
+    size_t used = out.size();
+    out.resize(used * 2);
+    cinfo->dest->next_output_byte = out.data() + used;
+    cinfo->dest->free_in_buffer = out.size() - used;
+    return TRUE;
+}
+
+void termDestination(j_compress_ptr cinfo) {
+    std::vector<uint8_t>& out = outputOf(cinfo);
+    out.resize(out.size() - cinfo->dest->free_in_buffer);
+}
+
+} // namespace
+
+TurboJpegEncoder::TurboJpegEncoder()
+    : jpeg_(std::make_unique<JpegState>()) {
+    JpegState& jpeg = *jpeg_;
+    jpeg.cinfo.err = jpeg_std_error(&jpeg.error.base);
+    jpeg.error.base.error_exit = onJpegError;
+    jpeg.error.message[0] = '\0';
+
+    if (setjmp(jpeg.error.jump)) {
+        logError_fmt("创建JPEG压缩器失败: {}", jpeg.error.message);
+        return;
+    }
+    jpeg_create_compress(&jpeg.cinfo);
+
+    jpeg.destination.init_destination = initDestination;
+    jpeg.destination.empty_output_buffer = emptyOutputBuffer;
+    jpeg.destination.term_destination = termDestination;
+    jpeg.cinfo.dest = &jpeg.destination;
+    jpeg.created = true;
+}
+
+TurboJpegEncoder::~TurboJpegEncoder() {
+    if (jpeg_->created) {
+        jpeg_destroy_compress(&jpeg_->cinfo);
+    }
+}
+
+bool TurboJpegEncoder::encode(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) {
+    return compress(frame, quality, luma, 0, out);
+}
+
+bool TurboJpegEncoder::encodeStripe(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) {
+    return compress(frame, quality, luma, 1, out);
+}
+
+bool TurboJpegEncoder::compress(const RawFrame& frame, int quality, bool luma, int restart_rows,
+                                std::vector<uint8_t>& out) {
+    JpegState& jpeg = *jpeg_;
+    out.clear();
+    if (!jpeg.created || !frame.valid()) {
+        return false;
+    }
+
+    // 行指针直接指向源帧，行跨度任意（子区域视图也无需复制）
+    jpeg.rows.resize(frame.height);
+    for (int y = 0; y < frame.height; y++) {
+        jpeg.rows[y] = frame.row(y);
+    }
+    jpeg.cinfo.client_data = &out;
+
+    // setjmp之后到longjmp之间不能有需要析构的局部对象
+    if (setjmp(jpeg.error.jump)) {
+        logError_fmt("JPEG编码失败: {}", jpeg.error.message);
+        jpeg_abort_compress(&jpeg.cinfo);
+        out.clear();
+        return false;
+    }
+
+    jpeg_compress_struct& cinfo = jpeg.cinfo;
+    cinfo.image_width = frame.width;
+    cinfo.image_height = frame.height;
+    cinfo.input_components = 4;
+    cinfo.in_color_space = JCS_EXT_BGRX;
+    jpeg_set_defaults(&cinfo);
+    if (luma) {
+        // 压缩器内部完成BGRX到亮度的转换，输出单通道JPEG
+        jpeg_set_colorspace(&cinfo, JCS_GRAYSCALE);
+    }
+    jpeg_set_quality(&cinfo, std::min(std::max(quality, 1), 100), TRUE);
+    // 默认的4:2:0采样下MCU为16行，灰度为8行，与stripeAlignment一致
+    cinfo.restart_in_rows = restart_rows;
+
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        jpeg_write_scanlines(&cinfo, jpeg.rows.data() + cinfo.next_scanline, cinfo.image_height - cinfo.next_scanline);
+    }
+    jpeg_finish_compress(&cinfo);
+
+    cinfo.client_data = nullptr;
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include "image_encoder.h"
+
+// libjpeg-turbo编码器：BGRX行指针直接送入压缩器（不转换、不复制像素），色彩转换和DCT使用SIMD
+// 压缩对象在帧间复用，输出通过自定义目标管理器直接写入调用方的缓冲区
+// jpeglib.h依赖stdio.h且定义了大量宏，因此libjpeg状态只在实现文件中定义
+class TurboJpegEncoder : public ImageEncoder {
+public:
+    TurboJpegEncoder();
+    ~TurboJpegEncoder() override;
+
+    bool encode(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) override;
+    bool encodeStripe(const RawFrame& frame, int quality, bool luma, std::vector<uint8_t>& out) override;
+    int stripeAlignment(bool luma) const override { return luma ? 8 : 16; }
+    const char* getName() const override { return "turbojpeg"; }
+
+private:
+    // restart_rows>0时每隔restart_rows个MCU行插入重启标记
+    bool compress(const RawFrame& frame, int quality, bool luma, int restart_rows, std::vector<uint8_t>& out);
+
+    struct JpegState;
+    std::unique_ptr<JpegState> jpeg_;
+};
@@ -0,0 +1,95 @@
+#include "mixed_raster.h"
+#include <algorithm>
+
+namespace {
+
+// 颜色比较忽略alpha
+constexpr uint32_t ALPHA_MASK = 0xFF000000;
+
+// 颜色表的最大容量
+constexpr int MAX_PALETTE = 64;
+
+// 块内颜色数在[2, max_colors]之间：纯色块交给JPEG（几乎不占空间），颜色超过上限时提前返回
+bool isUiBlock(const RawFrame& frame, const FrameRect& block, int max_colors) {
+    uint32_t palette[MAX_PALETTE];
+    int count = 0;
+    uint32_t last = 0;               // 上一个像素的颜色（alpha为0，不会与任何像素相同）
+
+    for (int y = block.y; y < block.y + block.height; y++) {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(frame.row(y)) + block.x;
+        for (int x = 0; x < block.width; x++) {
+            uint32_t color = row[x] | ALPHA_MASK;
+            if (color == last) {
+                continue;
+            }
+            last = color;
+
+            if (std::find(palette, palette + count, color) == palette + count) {
+                if (count == max_colors) {
+                    return false;
+                }
+                palette[count++] = color;
+            }
+        }
+    }
+    return count >= 2;
+}
+
+} // namespace
+
+void findUiRects(const RawFrame& frame, int block_size, int max_colors, std::vector<FrameRect>& rects) {
+    rects.clear();
+    if (!frame.valid() || block_size <= 0) {
+        return;
+    }
+    max_colors = std::min(std::max(max_colors, 2), MAX_PALETTE);
+
+    int blocks_x = (frame.width + block_size - 1) / block_size;
+    int blocks_y = (frame.height + block_size - 1) / block_size;
+
+    // 下边缘与当前块行顶端相接、可以继续向下合并的矩形
+    std::vector<size_t> open;
+    std::vector<size_t> next_open;
+
+    for (int by = 0; by < blocks_y; by++) {
+        int y = by * block_size;
+        int height = std::min(block_size, frame.height - y);
+        next_open.clear();
+
+        int bx = 0;
+        while (bx < blocks_x) {
+            FrameRect block{ bx * block_size, y, std::min(block_size, frame.width - bx * block_size), height };
+            if (!isUiBlock(frame, block, max_colors)) {
+                bx++;
+                continue;
+            }
+
+            // 合并同一行中相邻的界面块
+            int run_end = bx + 1;
+            while (run_end < blocks_x) {
+                FrameRect next{ run_end * block_size, y, std::min(block_size, frame.width - run_end * block_size), height };
+                if (!isUiBlock(frame, next, max_colors)) {
+                    break;
+                }
+                run_end++;
+            }
+
+            FrameRect run{ bx * block_size, y, std::min(run_end * block_size, frame.width) - bx * block_size, height };
+            auto match = std::find_if(open.begin(), open.end(), [&](size_t index) {
+                return rects[index].x == run.x && rects[index].width == run.width;
+            });
+            if (match != open.end()) {
+                rects[*match].height += height;
+                next_open.push_back(*match);
+            }
+            else {
+                rects.push_back(run);
+                next_open.push_back(rects.size() - 1);
+            }
+
+            // run_end处的块已判断为自然块
+            bx = run_end + 1;
+        }
+        open.swap(next_open);
+    }
+}
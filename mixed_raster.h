@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_source.h"
+
+// 混合光栅分层：把帧划分为block_size×block_size的块，颜色少（2~max_colors种）的块视为界面层
+// （HUD、数字、文字、边框），其余为自然图像层。界面块按行合并为水平条，横向范围相同的条再向下合并
+// block_size取16的倍数时，界面层矩形与JPEG的MCU对齐，自然层中被替换的区域不会影响相邻块
+void findUiRects(const RawFrame& frame, int block_size, int max_colors, std::vector<FrameRect>& rects);
@@ -0,0 +1,178 @@
+#include "motion_estimator.h"
+#include "simd_util.h"
+#include "LogWrapper.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+
+// 投影匹配的最小重叠比例（避免在边缘用极少样本得到虚假最优）
+constexpr double MIN_OVERLAP_RATIO = 0.6;
+
+// 最优平移的代价需低于零平移代价的该比例才视为可信
+constexpr double MIN_IMPROVEMENT_RATIO = 0.5;
+
+// 两个16位数组的绝对差之和
+uint64_t sumAbsDiff16(const uint16_t* a, const uint16_t* b, int count) {
+    uint64_t total = 0;
+    int i = 0;
+
+#ifdef FRAME_SIMD_X86
+    // 投影值不超过255×64，按有符号16位做madd不会溢出
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu16(va, vb), _mm_subs_epu16(vb, va));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(diff, ones));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    total = static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < count; i++) {
+        total += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    }
+    return total;
+}
+
+// 一维投影匹配：返回使current[i] ≈ reference[i - shift]的最优shift，找不到可信平移时返回0
+int matchProjection(const std::vector<uint16_t>& current, const std::vector<uint16_t>& reference, int max_shift) {
+    int size = static_cast<int>(current.size());
+    if (size == 0 || reference.size() != current.size()) {
+        return 0;
+    }
+
+    max_shift = std::min(max_shift, static_cast<int>(size * (1.0 - MIN_OVERLAP_RATIO)));
+
+    // 代价为重叠部分的平均绝对差（×256保留精度）
+    auto cost = [&](int shift) {
+        int overlap = size - std::abs(shift);
+        const uint16_t* cur = current.data() + std::max(shift, 0);
+        const uint16_t* ref = reference.data() + std::max(-shift, 0);
+        return sumAbsDiff16(cur, ref, overlap) * 256 / overlap;
+    };
+
+    uint64_t zero_cost = cost(0);
+    uint64_t best_cost = zero_cost;
+    int best_shift = 0;
+    for (int shift = -max_shift; shift <= max_shift; shift++) {
+        if (shift == 0) continue;
+        uint64_t c = cost(shift);
+        if (c < best_cost) {
+            best_cost = c;
+            best_shift = shift;
+        }
+    }
+
+    if (best_shift == 0 || best_cost > zero_cost * MIN_IMPROVEMENT_RATIO) {
+        return 0;
+    }
+    return best_shift;
+}
+
+} // namespace
+
+MotionEstimator::MotionEstimator()
+    : max_dx_(64), max_dy_(16) {
+}
+
+void MotionEstimator::setSearchRange(int max_dx, int max_dy) {
+    max_dx_ = std::max(max_dx, 0);
+    max_dy_ = std::max(max_dy, 0);
+}
+
+void MotionEstimator::computeProjections(const RawFrame& frame, std::vector<uint16_t>& columns,
+                                         std::vector<uint16_t>& rows) {
+    std::vector<uint32_t>& column_sums = column_sums_;
+    column_sums.assign(frame.width, 0);
+    rows.resize(frame.height);
+
+    for (int y = 0; y < frame.height; y++) {
+        const uint8_t* row = frame.row(y);
+        uint64_t row_sum = 0;
+        int x = 0;
+
+#ifdef FRAME_SIMD_X86
+        // 每次4个像素：B+G+R = (p & 0xFF) + ((p >> 8) & 0xFF) + ((p >> 16) & 0xFF)
+        const __m128i byte_mask = _mm_set1_epi32(0xFF);
+        __m128i row_acc = _mm_setzero_si128();
+        for (; x + 4 <= frame.width; x += 4) {
+            __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4));
+            __m128i sum = _mm_add_epi32(_mm_and_si128(p, byte_mask),
+                          _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(p, 8), byte_mask),
+                                        _mm_and_si128(_mm_srli_epi32(p, 16), byte_mask)));
+            __m128i* columns_ptr = reinterpret_cast<__m128i*>(column_sums.data() + x);
+            _mm_storeu_si128(columns_ptr, _mm_add_epi32(_mm_loadu_si128(columns_ptr), sum));
+            row_acc = _mm_add_epi32(row_acc, sum);
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), row_acc);
+        row_sum = static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+        for (; x < frame.width; x++) {
+            const uint8_t* p = row + x * 4;
+            uint32_t sum = p[0] + p[1] + p[2];
+            column_sums[x] += sum;
+            row_sum += sum;
+        }
+
+        rows[y] = static_cast<uint16_t>(row_sum * 64 / (static_cast<uint64_t>(frame.width) * 3));
+    }
+
+    columns.resize(frame.width);
+    uint64_t column_divisor = static_cast<uint64_t>(frame.height) * 3;
+    for (int x = 0; x < frame.width; x++) {
+        columns[x] = static_cast<uint16_t>(column_sums[x] * 64ULL / column_divisor);
+    }
+}
+
+PanEstimate MotionEstimator::estimate(const RawFrame& current, const RawFrame& reference) {
+    PanEstimate result;
+    if (!current.valid() || !reference.valid() ||
+        current.width != reference.width || current.height != reference.height) {
+        return result;
+    }
+
+    computeProjections(current, current_columns_, current_rows_);
+    computeProjections(reference, reference_columns_, reference_rows_);
+
+    result.dx = matchProjection(current_columns_, reference_columns_, max_dx_);
+    result.dy = matchProjection(current_rows_, reference_rows_, max_dy_);
+    result.valid = result.dx != 0 || result.dy != 0;
+    return result;
+}
+
+int computeShiftResidual(const RawFrame& current, const RawFrame& reference, int dx, int dy,
+                         DirtyTileMap& dirty) {
+    int dirty_count = 0;
+
+    for (int ty = 0; ty < dirty.tiles_y; ty++) {
+        for (int tx = 0; tx < dirty.tiles_x; tx++) {
+            FrameRect rect = dirty.tileRect(tx, ty, current.width, current.height);
+            int src_x = rect.x - dx;
+            int src_y = rect.y - dy;
+
+            // 平移后新露出的区域
+            bool changed = src_x < 0 || src_y < 0 ||
+                           src_x + rect.width > reference.width || src_y + rect.height > reference.height;
+
+            for (int y = 0; !changed && y < rect.height; y++) {
+                changed = memcmp(current.row(rect.y + y) + static_cast<size_t>(rect.x) * 4,
+                                 reference.row(src_y + y) + static_cast<size_t>(src_x) * 4,
+                                 static_cast<size_t>(rect.width) * 4) != 0;
+            }
+
+            if (changed) {
+                dirty.setDirty(tx, ty);
+                dirty_count++;
+            }
+        }
+    }
+
+    return dirty_count;
+}
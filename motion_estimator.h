@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_source.h"
+#include "frame_diff.h"
+
+// 全局平移估计结果：current(x, y) ≈ reference(x - dx, y - dy)
+struct PanEstimate {
+    int dx = 0;
+    int dy = 0;
+    bool valid = false;              // 是否找到可信的非零平移
+};
+
+// 全局运动估计器：横版场景行走时画面整体平移
+// 用行/列亮度投影（每列/每行的平均B+G+R）做一维匹配，投影计算和匹配使用SSE2向量化
+class MotionEstimator {
+public:
+    MotionEstimator();
+
+    // 设置搜索范围（像素）
+    void setSearchRange(int max_dx, int max_dy);
+
+    // 估计current相对reference的平移（两帧尺寸必须相同）
+    PanEstimate estimate(const RawFrame& current, const RawFrame& reference);
+
+    // 计算帧的列投影和行投影（平均亮度×64，16位）
+    void computeProjections(const RawFrame& frame, std::vector<uint16_t>& columns,
+                            std::vector<uint16_t>& rows);
+
+private:
+    int max_dx_;
+    int max_dy_;
+    std::vector<uint16_t> current_columns_;
+    std::vector<uint16_t> current_rows_;
+    std::vector<uint16_t> reference_columns_;
+    std::vector<uint16_t> reference_rows_;
+    std::vector<uint32_t> column_sums_;     // 列投影的累加缓冲区（跨帧复用）
+};
+
+// 计算current相对"reference平移(dx, dy)"的残差瓦片（dirty需已按帧尺寸reset）
+// 平移后新露出的区域和像素不完全相同的瓦片标记为脏，返回脏瓦片数
+int computeShiftResidual(const RawFrame& current, const RawFrame& reference, int dx, int dy,
+                         DirtyTileMap& dirty);
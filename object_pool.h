@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// 固定大小的对象池：预先创建capacity个对象循环复用
+// 对象以shared_ptr交给使用方，最后一个引用释放时显式归还到受互斥锁保护的空闲列表
+// shared_ptr的控制块放在每个槽位预留的内存中，复用的对象保留内部缓冲区的容量，稳定状态下不再分配内存
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity = 0) { setCapacity(capacity); }
+
+    // 设置对象数量（重新创建全部对象，已分配出去的对象归还时随旧池一起释放）
+    void setCapacity(size_t capacity) {
+        auto state = std::make_shared<State>();
+        state->slots.resize(capacity);
+        state->free.reserve(capacity);
+        for (Slot& slot : state->slots) {
+            slot.object.reset(new T());
+            state->free.push_back(&slot);
+        }
+        state_ = std::move(state);
+    }
+
+    size_t capacity() const { return state_->slots.size(); }
+
+    // 获取空闲对象，全部被占用时返回nullptr
+    std::shared_ptr<T> acquire() {
+        Slot* slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->free.empty()) {
+                return nullptr;
+            }
+            slot = state_->free.back();
+            state_->free.pop_back();
+        }
+        // 对象归槽位所有，删除器什么也不做；控制块释放时（所有强/弱引用都已消失）才归还槽位
+        return std::shared_ptr<T>(slot->object.get(), [](T*) {}, SlotAllocator<T>(state_, slot));
+    }
+
+private:
+    static constexpr size_t CONTROL_BLOCK_SIZE = 64;
+
+    struct Slot {
+        std::unique_ptr<T> object;
+        alignas(std::max_align_t) unsigned char control_block[CONTROL_BLOCK_SIZE]; // shared_ptr控制块的存储
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        std::vector<Slot*> free;    // 空闲槽位
+    };
+
+    // 控制块分配器：使用槽位内的预留内存，释放时把槽位放回空闲列表
+    // 持有State的引用，池被重新设置或销毁后仍能安全归还
+    template <typename U>
+    struct SlotAllocator {
+        using value_type = U;
+
+        SlotAllocator(std::shared_ptr<State> state, Slot* slot) : state(std::move(state)), slot(slot) {}
+        template <typename V>
+        SlotAllocator(const SlotAllocator<V>& other) : state(other.state), slot(other.slot) {}
+
+        U* allocate(size_t n) {
+            if (sizeof(U) * n <= CONTROL_BLOCK_SIZE && alignof(U) <= alignof(std::max_align_t)) {
+                return reinterpret_cast<U*>(slot->control_block);
+            }
+            return static_cast<U*>(::operator new(sizeof(U) * n));
+        }
+
+        void deallocate(U* p, size_t) {
+            if (reinterpret_cast<unsigned char*>(p) != slot->control_block) {
+                ::operator delete(p);
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->free.push_back(slot);
+        }
+
+        template <typename V>
+        bool operator==(const SlotAllocator<V>& other) const { return slot == other.slot; }
+        template <typename V>
+        bool operator!=(const SlotAllocator<V>& other) const { return slot != other.slot; }
+
+        std::shared_ptr<State> state;
+        Slot* slot;
+    };
+
+    std::shared_ptr<State> state_;
+};
@@ -0,0 +1,68 @@
+#include "pixel_convert.h"
+#include "simd_util.h"
+
+namespace {
+
+// 亮度权重（和为256）
+constexpr int LUMA_WEIGHT_B = 29;
+constexpr int LUMA_WEIGHT_G = 150;
+constexpr int LUMA_WEIGHT_R = 77;
+
+inline uint8_t lumaOf(const uint8_t* p) {
+    return static_cast<uint8_t>((p[0] * LUMA_WEIGHT_B + p[1] * LUMA_WEIGHT_G + p[2] * LUMA_WEIGHT_R + 128) >> 8);
+}
+
+#ifdef FRAME_SIMD_X86
+
+// 4个像素的亮度（32位整数，未舍入）：按16位展开后madd得到(B*wb+G*wg, R*wr)两两相加
+inline __m128i lumaSums4(__m128i lo_pixels, __m128i hi_pixels, __m128i weights) {
+    __m128i lo = _mm_madd_epi16(lo_pixels, weights);
+    __m128i hi = _mm_madd_epi16(hi_pixels, weights);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+void convertRowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m128i weights = _mm_setr_epi16(LUMA_WEIGHT_B, LUMA_WEIGHT_G, LUMA_WEIGHT_R, 0,
+                                           LUMA_WEIGHT_B, LUMA_WEIGHT_G, LUMA_WEIGHT_R, 0);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y[4];
+        for (int i = 0; i < 4; i++) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (x + i * 4) * 4));
+            __m128i sums = lumaSums4(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero), weights);
+            y[i] = _mm_srli_epi32(_mm_add_epi32(sums, round), 8);
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]), _mm_packs_epi32(y[2], y[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+    }
+    for (; x < width; x++) {
+        dst[x] = lumaOf(src + x * 4);
+    }
+}
+
+#else
+
+void convertRowScalar(const uint8_t* src, uint8_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = lumaOf(src + x * 4);
+    }
+}
+
+#endif
+
+} // namespace
+
+void convertToLuma(const RawFrame& frame, uint8_t* dst, int dst_stride) {
+    for (int y = 0; y < frame.height; y++) {
+#ifdef FRAME_SIMD_X86
+        convertRowSse2(frame.row(y), dst + static_cast<size_t>(y) * dst_stride, frame.width);
+#else
+        convertRowScalar(frame.row(y), dst + static_cast<size_t>(y) * dst_stride, frame.width);
+#endif
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include "frame_source.h"
+
+// BGRA转8位亮度（BT.601：Y = (29B + 150G + 77R + 128) >> 8），忽略Alpha
+// dst至少有frame.height行、每行dst_stride字节（dst_stride >= frame.width）
+// SSE2向量化，一次处理16个像素；非x86平台使用标量实现
+void convertToLuma(const RawFrame& frame, uint8_t* dst, int dst_stride);
@@ -0,0 +1,197 @@
+#include "qoi_codec.h"
+#include "simd_util.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RUN = 0xC0;
+constexpr uint8_t QOI_OP_RGB = 0xFE;
+constexpr int QOI_MAX_RUN = 62;
+constexpr size_t QOI_HEADER_SIZE = 14;
+const uint8_t QOI_END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// 像素按内存中的BGRA存放，alpha固定为255
+constexpr uint32_t ALPHA_MASK = 0xFF000000;
+
+// 平坦度估计的采样行间隔
+constexpr int FLAT_SAMPLE_ROW_STEP = 4;
+
+// 亮度权重，与pixel_convert.cpp一致
+constexpr int LUMA_WEIGHT_B = 29;
+constexpr int LUMA_WEIGHT_G = 150;
+constexpr int LUMA_WEIGHT_R = 77;
+
+inline uint32_t grayPixel(uint32_t bgra) {
+    uint32_t y = ((bgra & 0xFF) * LUMA_WEIGHT_B + ((bgra >> 8) & 0xFF) * LUMA_WEIGHT_G +
+                  ((bgra >> 16) & 0xFF) * LUMA_WEIGHT_R + 128) >> 8;
+    return ALPHA_MASK | (y << 16) | (y << 8) | y;
+}
+
+inline int indexOf(uint32_t bgra) {
+    uint32_t b = bgra & 0xFF;
+    uint32_t g = (bgra >> 8) & 0xFF;
+    uint32_t r = (bgra >> 16) & 0xFF;
+    return static_cast<int>((r * 3 + g * 5 + b * 7 + 255 * 11) & 63);
+}
+
+inline void writeBigEndian(uint8_t* dst, uint32_t value) {
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+// 从x开始与value相同（忽略alpha）的像素数，界面画面的大部分像素在这里一次跳过
+int runLength(const uint32_t* row, int x, int width, uint32_t value) {
+    int start = x;
+#ifdef FRAME_SIMD_X86
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+    const __m128i target = _mm_set1_epi32(static_cast<int>(value | ALPHA_MASK));
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), alpha);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(pixels, target)));
+        if (mask != 0xF) {
+            // 第一个不同像素之前的相同像素
+            while (mask & 1) {
+                x++;
+                mask >>= 1;
+            }
+            return x - start;
+        }
+    }
+#endif
+    while (x < width && (row[x] | ALPHA_MASK) == (value | ALPHA_MASK)) {
+        x++;
+    }
+    return x - start;
+}
+
+// 游程可以跨行，按QOI_MAX_RUN分段输出
+inline uint8_t* writeRun(uint8_t* dst, int& run) {
+    while (run >= QOI_MAX_RUN) {
+        *dst++ = QOI_OP_RUN | (QOI_MAX_RUN - 1);
+        run -= QOI_MAX_RUN;
+    }
+    return dst;
+}
+
+} // namespace
+
+void encodeQoi(const RawFrame& frame, bool luma, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!frame.valid()) {
+        return;
+    }
+
+    size_t max_size = QOI_HEADER_SIZE + static_cast<size_t>(frame.width) * frame.height * 4 + sizeof(QOI_END_MARKER);
+    out.resize(max_size);
+    uint8_t* dst = out.data();
+
+    std::memcpy(dst, "qoif", 4);
+    writeBigEndian(dst + 4, static_cast<uint32_t>(frame.width));
+    writeBigEndian(dst + 8, static_cast<uint32_t>(frame.height));
+    dst[12] = 3;                     // RGB
+    dst[13] = 0;                     // sRGB
+    dst += QOI_HEADER_SIZE;
+
+    uint32_t index[64] = {};
+    uint32_t previous = ALPHA_MASK;  // 规范规定的初始像素(0, 0, 0, 255)
+    uint32_t previous_source = ALPHA_MASK;
+    int run = 0;
+
+    for (int y = 0; y < frame.height; y++) {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(frame.row(y));
+        int x = 0;
+        while (x < frame.width) {
+            // 源像素相同时输出像素必然相同（灰度模式下也成立）
+            int same = runLength(row, x, frame.width, previous_source);
+            if (same > 0) {
+                run += same;
+                x += same;
+                dst = writeRun(dst, run);
+                continue;
+            }
+
+            if (run > 0) {
+                *dst++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            uint32_t source = row[x++] | ALPHA_MASK;
+            uint32_t pixel = luma ? grayPixel(source) : source;
+            previous_source = source;
+            if (pixel == previous) {
+                // 灰度模式下不同颜色可能得到相同亮度
+                run++;
+                continue;
+            }
+
+            int hash = indexOf(pixel);
+            if (index[hash] == pixel) {
+                *dst++ = static_cast<uint8_t>(QOI_OP_INDEX | hash);
+            }
+            else {
+                index[hash] = pixel;
+                int8_t dr = static_cast<int8_t>(((pixel >> 16) & 0xFF) - ((previous >> 16) & 0xFF));
+                int8_t dg = static_cast<int8_t>(((pixel >> 8) & 0xFF) - ((previous >> 8) & 0xFF));
+                int8_t db = static_cast<int8_t>((pixel & 0xFF) - (previous & 0xFF));
+                int8_t dr_dg = static_cast<int8_t>(dr - dg);
+                int8_t db_dg = static_cast<int8_t>(db - dg);
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *dst++ = static_cast<uint8_t>(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    *dst++ = static_cast<uint8_t>(QOI_OP_LUMA | (dg + 32));
+                    *dst++ = static_cast<uint8_t>(((dr_dg + 8) << 4) | (db_dg + 8));
+                }
+                else {
+                    *dst++ = QOI_OP_RGB;
+                    *dst++ = static_cast<uint8_t>(pixel >> 16);
+                    *dst++ = static_cast<uint8_t>(pixel >> 8);
+                    *dst++ = static_cast<uint8_t>(pixel);
+                }
+            }
+            previous = pixel;
+            dst = writeRun(dst, run);
+        }
+    }
+
+    if (run > 0) {
+        *dst++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+    }
+    std::memcpy(dst, QOI_END_MARKER, sizeof(QOI_END_MARKER));
+    dst += sizeof(QOI_END_MARKER);
+    out.resize(static_cast<size_t>(dst - out.data()));
+}
+
+double flatPixelRatio(const RawFrame& frame) {
+    if (!frame.valid() || frame.width < 2) {
+        return 0.0;
+    }
+
+    uint64_t same = 0;
+    uint64_t total = 0;
+    for (int y = 0; y < frame.height; y += FLAT_SAMPLE_ROW_STEP) {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(frame.row(y));
+        int x = 1;
+#ifdef FRAME_SIMD_X86
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+        for (; x + 4 <= frame.width; x += 4) {
+            __m128i current = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), alpha);
+            __m128i left = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1)), alpha);
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(current, left)));
+            same += ((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+        }
+#endif
+        for (; x < frame.width; x++) {
+            same += (row[x] | ALPHA_MASK) == (row[x - 1] | ALPHA_MASK);
+        }
+        total += frame.width - 1;
+    }
+
+    return total > 0 ? static_cast<double>(same) / total : 0.0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_source.h"
+
+// QOI无损编码（https://qoiformat.org/qoi-specification.pdf）：游程、64项颜色索引、小差值和亮度差值
+// 用于背包、商店、对话框等平坦的界面画面：文字边缘无损，编码速度远高于JPEG
+// 输出为3通道QOI（忽略alpha）；luma为真时每个像素编码为与convertToLuma相同的灰度值(Y, Y, Y)
+// out被覆盖（复用其容量），最坏情况下每像素4字节
+void encodeQoi(const RawFrame& frame, bool luma, std::vector<uint8_t>& out);
+
+// 估计帧的平坦程度：隔行采样，与左侧像素颜色完全相同的像素比例(0-1)
+// 界面和文字画面通常在0.7以上，游戏场景明显更低
+double flatPixelRatio(const RawFrame& frame);
@@ -0,0 +1,91 @@
+#include "rate_control.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 质量0、10、...、100的相对大小（多种画面实测的折中，质量80为1）
+const double RELATIVE_SIZE[] = { 0.20, 0.25, 0.30, 0.36, 0.43, 0.50, 0.58, 0.75, 1.00, 1.50, 6.00 };
+
+// 复杂度指数平均的权重
+constexpr double COMPLEXITY_ALPHA = 0.3;
+
+// 超出目标该比例以上时重编码
+constexpr double RETRY_OVERSHOOT = 1.2;
+
+// 实测复杂度与估计相差该倍数以上时视为画面类型变化（如城镇进入副本），直接采用实测值
+const double COMPLEXITY_JUMP = std::log(1.5);
+
+} // namespace
+
+RateController::RateController()
+    : target_bytes_(0), min_quality_(30), max_quality_(90), has_estimate_(false), log_complexity_(0.0) {
+}
+
+void RateController::configure(size_t target_bytes, int min_quality, int max_quality) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    target_bytes_ = target_bytes;
+    min_quality_ = std::min(std::max(min_quality, 1), 100);
+    max_quality_ = std::min(std::max(max_quality, min_quality_), 100);
+    has_estimate_ = false;
+}
+
+void RateController::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_estimate_ = false;
+}
+
+double RateController::relativeSize(int quality) {
+    // 相邻表项之间按对数插值
+    quality = std::min(std::max(quality, 0), 100);
+    int index = std::min(quality / 10, 9);
+    double t = (quality - index * 10) / 10.0;
+    return std::exp(std::log(RELATIVE_SIZE[index]) * (1.0 - t) + std::log(RELATIVE_SIZE[index + 1]) * t);
+}
+
+int RateController::qualityFor(size_t pixels, double log_complexity) const {
+    // 相对大小随质量单调增加，从高到低找第一个不超出目标的质量
+    double budget = std::log(static_cast<double>(target_bytes_)) - std::log(static_cast<double>(std::max<size_t>(pixels, 1))) - log_complexity;
+    for (int quality = max_quality_; quality > min_quality_; quality--) {
+        if (std::log(relativeSize(quality)) <= budget) {
+            return quality;
+        }
+    }
+    return min_quality_;
+}
+
+int RateController::chooseQuality(size_t pixels, int fallback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_estimate_) {
+        return std::min(std::max(fallback, min_quality_), max_quality_);
+    }
+    return qualityFor(pixels, log_complexity_);
+}
+
+void RateController::record(size_t pixels, int quality, size_t bytes) {
+    if (pixels == 0 || bytes == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    double observed = std::log(static_cast<double>(bytes) / (static_cast<double>(pixels) * relativeSize(quality)));
+    if (has_estimate_ && std::fabs(observed - log_complexity_) < COMPLEXITY_JUMP) {
+        log_complexity_ += COMPLEXITY_ALPHA * (observed - log_complexity_);
+    }
+    else {
+        log_complexity_ = observed;
+    }
+    has_estimate_ = true;
+}
+
+int RateController::retryQuality(size_t pixels, int quality, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (target_bytes_ == 0 || pixels == 0 || bytes <= target_bytes_ * RETRY_OVERSHOOT || quality <= min_quality_) {
+        return 0;
+    }
+
+    // 同一帧重编码，直接使用本帧的复杂度
+    double observed = std::log(static_cast<double>(bytes) / (static_cast<double>(pixels) * relativeSize(quality)));
+    int retry = qualityFor(pixels, observed);
+    return retry < quality ? retry : 0;
+}
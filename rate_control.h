@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+// 码率控制：按每帧目标字节数选择JPEG质量
+// 大小预测：字节数 ≈ 像素数 × 复杂度 × 相对大小(质量)，相对大小为固定的质量曲线（质量80时为1），
+// 复杂度（质量80下每像素字节数）由最近编码的帧按对数域指数平均学习，画面类型突变时直接采用实测值；
+// 预测偏差过大时用本帧实测值修正后重编码一次
+// 目标在接收线程中设置，各方法线程安全
+class RateController {
+public:
+    RateController();
+
+    // 设置每帧目标字节数和质量范围（会清除学习结果），target_bytes为0时禁用
+    void configure(size_t target_bytes, int min_quality, int max_quality);
+    bool enabled() const { return target_bytes_ > 0; }
+    size_t targetBytes() const { return target_bytes_; }
+
+    // 为pixels个像素的编码选择质量（尚无学习结果时返回fallback，限制在质量范围内）
+    int chooseQuality(size_t pixels, int fallback);
+
+    // 记录一次编码结果，更新复杂度估计
+    void record(size_t pixels, int quality, size_t bytes);
+
+    // 编码结果超出目标过多时，按本帧实测的复杂度重新选择质量，返回0表示不需要重编码
+    int retryQuality(size_t pixels, int quality, size_t bytes);
+
+    // 清除学习结果（画面类型或编码方式变化后）
+    void reset();
+
+private:
+    // 质量对应的相对大小（质量80为1）
+    static double relativeSize(int quality);
+
+    // 复杂度为log_complexity时满足目标的最高质量
+    int qualityFor(size_t pixels, double log_complexity) const;
+
+    std::atomic<size_t> target_bytes_;
+    int min_quality_;
+    int max_quality_;
+    bool has_estimate_;
+    double log_complexity_;          // 质量80下每像素字节数的对数（指数平均）
+    std::mutex mutex_;
+};
@@ -1,3 +1,4 @@
+#ifdef _WIN32
 #include <windows.h>
 #include <objbase.h> // 提供PROPID定义
 
@@ -16,15 +17,27 @@ typedef ULONG PROPID;
 #include <DirectXMath.h>
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
+#include <objidl.h>
+#endif
 
 // 然后包含其他头文件
 #include "LogWrapper.h"
 #include <memory>
 #include <algorithm>
+#include <iterator>
 #include <chrono>
-#include <objidl.h>
+#include <thread>
+#include <atomic>
+#include <cstring>
 #include "screen_capture.h"
-
+#include "image_resize.h"
+#include "image_encoder.h"
+#include "jpeg_stripes.h"
+#include "mixed_raster.h"
+#include "qoi_codec.h"
+#include "rate_control.h"
+
+#ifdef _WIN32
 using namespace Gdiplus;
 
 // RAII包装器GDI+
@@ -58,41 +71,88 @@ private:
 
 // 静态GDI+初始化器
 static GdiplusInitializer gdiplusInit;
+#endif
+
+// 用纯色填充矩形（矩形需已裁剪到帧内）
+static void fillRect(const RawFrame& frame, const FrameRect& rect, uint32_t color) {
+    for (int y = rect.y; y < rect.y + rect.height; y++) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame.row(y)) + rect.x;
+        std::fill(row, row + rect.width, color);
+    }
+}
 
-// 帮助函数获取JPEG编码器CLSID
-int GetEncoderClsid(const WCHAR* format, CLSID* pClsid) {
-    UINT num = 0;          // 编码器数量
-    UINT size = 0;         // 编码器信息大小
+// 将遮罩区域填充为纯色
+static void fillMasks(const RawFrame& frame, const std::vector<MaskRegion>& masks) {
+    for (const MaskRegion& mask : masks) {
+        FrameRect rect = clipRect(mask.rect, frame.width, frame.height);
+        if (!rect.empty()) {
+            fillRect(frame, rect, mask.color);
+        }
+    }
+}
 
-    // 获取图像编码器信息
-    GetImageEncodersSize(&num, &size);
-    if (size == 0) {
-        return -1;
+// 用矩形上方一行像素覆盖矩形（矩形在顶部时使用下方一行）
+static void paintOverRect(const RawFrame& frame, const FrameRect& rect) {
+    int source_y = rect.y > 0 ? rect.y - 1 : rect.y + rect.height;
+    if (source_y >= frame.height) {
+        return;
     }
 
-    // 分配内存
-    ImageCodecInfo* pImageCodecInfo = static_cast<ImageCodecInfo*>(malloc(size));
-    if (pImageCodecInfo == NULL) {
-        return -1;
+    const uint8_t* source = frame.row(source_y) + static_cast<size_t>(rect.x) * 4;
+    for (int y = rect.y; y < rect.y + rect.height; y++) {
+        memcpy(frame.row(y) + static_cast<size_t>(rect.x) * 4, source, static_cast<size_t>(rect.width) * 4);
     }
+}
 
-    // 获取编码器信息
-    GetImageEncoders(num, size, pImageCodecInfo);
+// 相对关键帧变化的瓦片超过该比例时直接发送关键帧
+constexpr double DELTA_MAX_DIRTY_RATIO = 0.5;
 
-    // 查找指定格式的编码器
-    int result = -1;
-    for (UINT i = 0; i < num; ++i) {
-        if (wcscmp(pImageCodecInfo[i].MimeType, format) == 0) {
-            *pClsid = pImageCodecInfo[i].Clsid;
-            result = i;
-            break;
-        }
+// 混合光栅的分块大小（MCU高度16的倍数）
+constexpr int MIXED_BLOCK_SIZE = 32;
+
+// 每个子流的结果对象池大小（等待发送的结果占用对象）
+constexpr size_t STREAM_RESULTS_PER_STREAM = 4;
+
+// 条带并行编码时每个条带的最小行数（更小的图像直接编码）
+constexpr int MIN_STRIPE_ROWS = 128;
+
+// 结果中整帧/增量区域和界面层的编码字节数（不含关注区域）
+static size_t encodedBytes(const CaptureResult& result) {
+    size_t bytes = result.jpeg_data.size();
+    for (const EncodedPatch& patch : result.patches) {
+        bytes += patch.data.size();
+    }
+    for (const EncodedPatch& patch : result.overlays) {
+        bytes += patch.data.size();
     }
+    return bytes;
+}
 
-    free(pImageCodecInfo);
-    return result;
+// 区域列表的总像素数
+static size_t patchPixels(const std::vector<EncodedPatch>& patches) {
+    size_t pixels = 0;
+    for (const EncodedPatch& patch : patches) {
+        pixels += static_cast<size_t>(patch.rect.width) * patch.rect.height;
+    }
+    return pixels;
 }
 
+// 当前线程的编码器：编码器保留压缩状态，不能跨线程共享，
+// 主线程、增量编码线程和条带编码线程各自持有一个实例，帧间复用
+static ImageEncoder* threadEncoder(const std::string& name) {
+    thread_local std::unique_ptr<ImageEncoder> encoder;
+    thread_local std::string encoder_name;
+    if (!encoder || encoder_name != name) {
+        encoder = createImageEncoder(name);
+        encoder_name = name;
+        if (!encoder) {
+            logError_fmt("编码器不可用: {}", name);
+        }
+    }
+    return encoder.get();
+}
+
+#ifdef _WIN32
 // 使用DXGI进行屏幕捕获的类
 class DXGIScreenCapture {
 public:
@@ -151,9 +211,10 @@ public:
         return true;
     }
 
-    std::vector<uint8_t> captureScreen(const RECT& targetRect, int quality) {
+    // 捕获目标区域到BGRA缓冲区（行跨度为宽度*4）
+    bool captureFrame(const RECT& targetRect, std::vector<uint8_t>& buffer) {
         if (!initialized_ && !initialize()) {
-            return {};
+            return false;
         }
 
         try {
@@ -166,7 +227,7 @@ public:
             HRESULT hr = dxgiOutput1_->DuplicateOutput(d3dDevice_, &duplication);
             if (FAILED(hr)) {
                 logError_fmt("创建输出复制器失败: 0x{:X}", hr);
-                return {};
+                return false;
             }
 
             // 创建纹理描述
@@ -188,7 +249,7 @@ public:
             if (FAILED(hr)) {
                 logError_fmt("创建暂存纹理失败: 0x{:X}", hr);
                 duplication->Release();
-                return {};
+                return false;
             }
 
             // 等待下一帧
@@ -201,13 +262,13 @@ public:
                 logWarn("获取帧超时");
                 stagingTexture->Release();
                 duplication->Release();
-                return {};
+                return false;
             }
             else if (FAILED(hr)) {
                 logError_fmt("获取帧失败: 0x{:X}", hr);
                 stagingTexture->Release();
                 duplication->Release();
-                return {};
+                return false;
             }
 
             // 获取桌面纹理
@@ -219,7 +280,7 @@ public:
                 stagingTexture->Release();
                 duplication->ReleaseFrame();
                 duplication->Release();
-                return {};
+                return false;
             }
 
             // 复制区域到暂存纹理
@@ -243,11 +304,16 @@ public:
                 stagingTexture->Release();
                 duplication->ReleaseFrame();
                 duplication->Release();
-                return {};
+                return false;
             }
 
-            // 创建位图
-            Bitmap bitmap(width, height, mappedResource.RowPitch, PixelFormat32bppARGB, static_cast<BYTE*>(mappedResource.pData));
+            // 复制像素数据（行跨度可能大于宽度*4）
+            size_t row_bytes = static_cast<size_t>(width) * 4;
+            buffer.resize(row_bytes * height);
+            const uint8_t* src = static_cast<const uint8_t*>(mappedResource.pData);
+            for (int y = 0; y < height; y++) {
+                memcpy(buffer.data() + row_bytes * y, src + static_cast<size_t>(mappedResource.RowPitch) * y, row_bytes);
+            }
 
             // 释放映射
             d3dContext_->Unmap(stagingTexture, 0);
@@ -259,64 +325,15 @@ public:
             duplication->Release();
             stagingTexture->Release();
 
-            // 压缩为JPEG
-            std::vector<uint8_t> jpegData;
-            saveToJpeg(bitmap, jpegData, quality);
-
-            return jpegData;
+            return true;
         }
         catch (std::exception& e) {
             logError_fmt("捕获屏幕时异常: {}", e.what());
-            return {};
-        }
-    }
-
-private:
-    bool saveToJpeg(Bitmap& bitmap, std::vector<uint8_t>& output, int quality) {
-        // 获取JPEG编码器
-        CLSID jpegClsid;
-        GetEncoderClsid(L"image/jpeg", &jpegClsid);
-
-        // 设置编码参数
-        EncoderParameters encoderParams;
-        encoderParams.Count = 1;
-        encoderParams.Parameter[0].Guid = EncoderQuality;
-        encoderParams.Parameter[0].Type = EncoderParameterValueTypeLong;
-        encoderParams.Parameter[0].NumberOfValues = 1;
-        ULONG qualityValue = quality;
-        encoderParams.Parameter[0].Value = &qualityValue;
-
-        // 创建内存流
-        IStream* stream = nullptr;
-        CreateStreamOnHGlobal(NULL, TRUE, &stream);
-
-        // 保存到流
-        Status status = bitmap.Save(stream, &jpegClsid, &encoderParams);
-        if (status != Ok) {
-            logError_fmt("保存JPEG失败: {}", static_cast<int>(status));
-            stream->Release();
             return false;
         }
-
-        // 获取数据大小
-        STATSTG stat;
-        stream->Stat(&stat, STATFLAG_NONAME);
-        ULONG size = stat.cbSize.LowPart;
-
-        // 重置流位置
-        LARGE_INTEGER li = { 0 };
-        stream->Seek(li, STREAM_SEEK_SET, NULL);
-
-        // 读取数据
-        output.resize(size);
-        ULONG bytesRead = 0;
-        stream->Read(output.data(), size, &bytesRead);
-
-        // 释放流
-        stream->Release();
-        return true;
     }
 
+private:
     void cleanup() {
         if (dxgiOutput1_) {
             dxgiOutput1_->Release();
@@ -353,12 +370,63 @@ private:
     IDXGIOutput* dxgiOutput_ = nullptr;
     IDXGIOutput1* dxgiOutput1_ = nullptr;
 };
+#endif
 
-ScreenCapture::ScreenCapture() : game_window_(NULL), window_dc_(NULL), memory_dc_(NULL), use_dxgi_(false), last_capture_time_(0) {
-    if (!gdiplusInit.isInitialized()) {
-        logError("GDI+初始化失败，屏幕捕获将不工作");
+// ==================== CaptureResult ====================
+
+void CaptureResult::reset() {
+    jpeg_data.clear();
+    width = 0;
+    height = 0;
+    source_width = 0;
+    source_height = 0;
+    window_rect = { 0, 0, 0, 0 };
+    is_keyframe = true;
+    keyframe_id = 0;
+    clearPatches(patches);
+    clearPatches(regions);
+    clearPatches(overlays);
+    roi_only = false;
+    scene_change = false;
+    is_pan = false;
+    pan_dx = 0;
+    pan_dy = 0;
+    pan_reference_id = 0;
+    thumbnail = false;
+    frame_id = 0;
+    content_digest = FrameDigest();
+    content_cached = false;
+    luma_only = false;
+    lossless = false;
+    mixed = false;
+    quality = 0;
+}
+
+std::vector<uint8_t> CaptureResult::takeBuffer() {
+    if (spare_buffers_.empty()) {
+        return {};
     }
-    gdiplusToken_ = gdiplusInit.getToken();
+    std::vector<uint8_t> buffer = std::move(spare_buffers_.back());
+    spare_buffers_.pop_back();
+    return buffer;
+}
+
+void CaptureResult::clearPatches(std::vector<EncodedPatch>& list) {
+    for (EncodedPatch& patch : list) {
+        patch.data.clear();
+        spare_buffers_.push_back(std::move(patch.data));
+    }
+    list.clear();
+}
+
+// ==================== WindowFrameSource ====================
+
+#ifdef _WIN32
+
+WindowFrameSource::WindowFrameSource()
+    : game_window_(NULL), window_dc_(NULL), memory_dc_(NULL), dib_bitmap_(NULL), dib_bits_(nullptr),
+      dib_width_(0), dib_height_(0), use_dxgi_(false) {
+    window_rect_ = { 0, 0, 0, 0 };
 
     // 尝试初始化DXGI捕获
     dxgi_capture_ = new DXGIScreenCapture();
@@ -367,30 +435,42 @@ ScreenCapture::ScreenCapture() : game_window_(NULL), window_dc_(NULL), memory_dc
         logInfo("已启用DXGI屏幕捕获");
     }
     else {
-        logInfo("DXGI屏幕捕获初始化失败，将使用GDI+捕获");
+        logInfo("DXGI屏幕捕获初始化失败，将使用GDI捕获");
     }
-
-    // 初始化差异检测
-    last_frame_hash_ = 0;
-    minimum_capture_interval_ms_ = 50; // 最小捕获间隔，避免过于频繁
 }
 
-ScreenCapture::~ScreenCapture() {
+WindowFrameSource::~WindowFrameSource() {
     // 清理资源
+    releaseGdiResources();
+    if (dxgi_capture_) {
+        delete dxgi_capture_;
+    }
+}
+
+void WindowFrameSource::releaseGdiResources() {
+    if (dib_bitmap_) {
+        DeleteObject(dib_bitmap_);
+        dib_bitmap_ = NULL;
+        dib_bits_ = nullptr;
+        dib_width_ = 0;
+        dib_height_ = 0;
+    }
     if (memory_dc_) {
         DeleteDC(memory_dc_);
+        memory_dc_ = NULL;
     }
     if (window_dc_) {
         ReleaseDC(game_window_, window_dc_);
-    }
-    if (dxgi_capture_) {
-        delete dxgi_capture_;
+        window_dc_ = NULL;
     }
 }
 
-bool ScreenCapture::initialize(const std::string& window_title) {
+bool WindowFrameSource::initialize(const std::string& window_title) {
     window_title_ = window_title;
 
+    // 重新初始化时释放旧窗口的资源
+    releaseGdiResources();
+
     // 查找游戏窗口
     if (!findGameWindow()) {
         logError_fmt("找不到游戏窗口: {}", window_title);
@@ -413,11 +493,10 @@ bool ScreenCapture::initialize(const std::string& window_title) {
         return false;
     }
 
-    logInfo_fmt("屏幕捕获初始化成功，目标窗口: {}", window_title);
     return true;
 }
 
-bool ScreenCapture::findGameWindow() {
+bool WindowFrameSource::findGameWindow() {
     // 清除之前的窗口句柄
     game_window_ = NULL;
 
@@ -464,7 +543,208 @@ bool ScreenCapture::findGameWindow() {
     return true;
 }
 
-std::shared_ptr<CaptureResult> ScreenCapture::captureScreen(int quality) {
+bool WindowFrameSource::acquireFrame(RawFrame& frame) {
+    if (!isValid()) {
+        return false;
+    }
+
+    // 更新窗口矩形
+    GetWindowRect(game_window_, &window_rect_);
+
+    // 计算窗口大小
+    int width = window_rect_.right - window_rect_.left;
+    int height = window_rect_.bottom - window_rect_.top;
+
+    // 检查窗口是否过小或无效
+    if (width <= 0 || height <= 0 || width > 7680 || height > 4320) {
+        logError_fmt("无效的窗口尺寸: {}x{}", width, height);
+        return false;
+    }
+
+    // 使用DXGI或fallback到GDI
+    if (use_dxgi_ && dxgi_capture_) {
+        if (dxgi_capture_->captureFrame(window_rect_, dxgi_buffer_)) {
+            frame.data = dxgi_buffer_.data();
+            frame.stride = width * 4;
+            frame.width = width;
+            frame.height = height;
+            frame.timestamp_us = frameClockMicros();
+            return true;
+        }
+
+        // 如果DXGI失败，fallback到GDI
+        use_dxgi_ = false;
+        logWarn("DXGI捕获失败，切换到GDI捕获");
+    }
+
+    if (!captureWindowImage(width, height)) {
+        logError("捕获窗口图像失败");
+        return false;
+    }
+
+    frame.data = dib_bits_;
+    frame.stride = width * 4;
+    frame.width = width;
+    frame.height = height;
+    frame.timestamp_us = frameClockMicros();
+    return true;
+}
+
+bool WindowFrameSource::captureWindowImage(int width, int height) {
+    // 检查窗口是否最小化
+    if (IsIconic(game_window_)) {
+        logWarn("游戏窗口已最小化，无法捕获");
+        return false;
+    }
+
+    // 窗口尺寸变化时重建DIB（自顶向下32位BGRA，像素可直接访问）
+    if (!dib_bitmap_ || dib_width_ != width || dib_height_ != height) {
+        if (dib_bitmap_) {
+            DeleteObject(dib_bitmap_);
+            dib_bitmap_ = NULL;
+            dib_bits_ = nullptr;
+        }
+
+        BITMAPINFO bmi;
+        ZeroMemory(&bmi, sizeof(bmi));
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        void* bits = nullptr;
+        dib_bitmap_ = CreateDIBSection(window_dc_, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+        if (!dib_bitmap_ || !bits) {
+            logError("创建DIB位图失败");
+            dib_bitmap_ = NULL;
+            return false;
+        }
+
+        dib_bits_ = static_cast<uint8_t*>(bits);
+        dib_width_ = width;
+        dib_height_ = height;
+    }
+
+    // 选择位图到内存DC
+    HBITMAP old_bitmap = (HBITMAP)SelectObject(memory_dc_, dib_bitmap_);
+
+    // 尝试使用PrintWindow捕获
+    BOOL result = PrintWindow(game_window_, memory_dc_, PW_CLIENTONLY);
+
+    // 如果PrintWindow失败，尝试使用BitBlt
+    if (!result || GetLastError() != 0) {
+        result = BitBlt(memory_dc_, 0, 0, width, height, window_dc_, 0, 0, SRCCOPY);
+    }
+
+    // 恢复旧位图
+    SelectObject(memory_dc_, old_bitmap);
+
+    if (!result) {
+        logError_fmt("捕获窗口内容失败，错误码: {}", GetLastError());
+        return false;
+    }
+
+    // 确保GDI绘制已完成再访问像素
+    GdiFlush();
+    return true;
+}
+
+bool WindowFrameSource::isValid() const {
+    return game_window_ != NULL && IsWindow(game_window_);
+}
+
+FrameRect WindowFrameSource::getSourceRect() const {
+    return { window_rect_.left, window_rect_.top,
+             window_rect_.right - window_rect_.left, window_rect_.bottom - window_rect_.top };
+}
+
+#endif // _WIN32
+
+// ==================== ScreenCapture ====================
+
+ScreenCapture::ScreenCapture()
+    : window_source_(nullptr), last_capture_time_(0), pending_scene_change_(false), scene_change_deferred_(false),
+      cursor_mask_enabled_(false), cursor_mask_size_(32), cursor_mask_paint_(false), has_cursor_(false),
+      cursor_pos_{ 0, 0 }, last_cursor_pos_{ 0, 0 },
+      delta_enabled_(false), keyframe_interval_(30), frames_since_keyframe_(0), keyframe_id_(0),
+      force_keyframe_(false), luma_only_(false), encoder_name_(defaultImageEncoderName()),
+      image_codec_(ImageCodec::JPEG), lossless_flat_ratio_(0.7), lossless_keyframe_(false), mixed_max_colors_(32),
+      output_max_width_(0), output_max_height_(0),
+      pan_enabled_(false), pan_reference_(0), pan_reference_id_(-1),
+      thumbnail_enabled_(false), thumbnail_max_width_(480), thumbnail_max_height_(270), thumbnail_quality_(60),
+      frame_id_(0), frame_history_(0) {
+#ifdef _WIN32
+    if (!gdiplusInit.isInitialized()) {
+        logError("GDI+初始化失败，屏幕捕获将不工作");
+    }
+    gdiplusToken_ = gdiplusInit.getToken();
+#endif
+
+    minimum_capture_interval_ms_ = 50; // 最小捕获间隔，避免过于频繁
+}
+
+ScreenCapture::~ScreenCapture() {
+}
+
+void ScreenCapture::setFrameSource(std::unique_ptr<FrameSource> source) {
+    frame_source_ = std::move(source);
+    window_source_ = nullptr;
+    last_capture_result_.reset();
+    change_detector_.reset();
+    change_metric_.reset();
+    keyframe_hashes_.clear();
+}
+
+void ScreenCapture::setDeltaEncoding(bool enabled, int keyframe_interval) {
+    delta_enabled_ = enabled;
+    keyframe_interval_ = std::max(1, keyframe_interval);
+    force_keyframe_ = true;
+    logInfo_fmt("增量帧编码: {}，关键帧间隔: {} 帧", enabled ? "启用" : "禁用", keyframe_interval_);
+}
+
+void ScreenCapture::setRoiSettings(const RoiSettings& settings) {
+    std::lock_guard<std::mutex> lock(settings_mutex_);
+    roi_settings_ = settings;
+    logInfo_fmt("已更新关注区域: {} 个，整帧: {}", settings.regions.size(),
+        settings.include_full ? "发送" : "不发送");
+}
+
+bool ScreenCapture::initialize(const std::string& window_title) {
+    // 已设置非窗口帧源时直接使用
+    if (frame_source_ && !window_source_) {
+        if (!frame_source_->isValid()) {
+            logError_fmt("帧源不可用: {}", frame_source_->getName());
+            return false;
+        }
+        logInfo_fmt("屏幕捕获初始化成功，帧源: {}", frame_source_->getName());
+        return true;
+    }
+
+#ifdef _WIN32
+    if (!window_source_) {
+        auto source = std::make_unique<WindowFrameSource>();
+        window_source_ = source.get();
+        frame_source_ = std::move(source);
+    }
+
+    if (!window_source_->initialize(window_title)) {
+        return false;
+    }
+
+    logInfo_fmt("屏幕捕获初始化成功，目标窗口: {}", window_title);
+    return true;
+#else
+    // 其他平台没有游戏窗口帧源，需先通过setFrameSource设置（X11、合成、回放等）
+    logError_fmt("未设置帧源，无法捕获窗口: {}", window_title);
+    return false;
+#endif
+}
+
+std::shared_ptr<CaptureResult> ScreenCapture::captureScreen(int quality, CaptureChange& change) {
+    change = CaptureChange();
+
     // 检查窗口是否有效
     if (!isWindowValid()) {
         logError("无效的游戏窗口");
@@ -476,8 +756,8 @@ std::shared_ptr<CaptureResult> ScreenCapture::captureScreen(int quality) {
     auto ms_since_last_capture = std::chrono::duration_cast<std::chrono::milliseconds>(
         current_time - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_capture_time_))).count();
 
-    if (ms_since_last_capture < minimum_capture_interval_ms_) {
-        // 捕获太频繁，重用上一帧
+    if (ms_since_last_capture < minimum_capture_interval_ms_ && !pending_scene_change_) {
+        // 捕获太频繁，重用上一帧（场景切换不受节流限制）
         if (last_capture_result_) {
             return last_capture_result_;
         }
@@ -485,221 +765,938 @@ std::shared_ptr<CaptureResult> ScreenCapture::captureScreen(int quality) {
 
     last_capture_time_ = std::chrono::steady_clock::now().time_since_epoch().count();
 
-    // 更新窗口矩形
-    GetWindowRect(game_window_, &window_rect_);
+    // 获取原始帧
+    RawFrame frame;
+    if (!frame_source_->acquireFrame(frame)) {
+        logError_fmt("获取帧失败，帧源: {}", frame_source_->getName());
+        return nullptr;
+    }
 
-    // 计算窗口大小
-    int width = window_rect_.right - window_rect_.left;
-    int height = window_rect_.bottom - window_rect_.top;
+    // 遮罩区域填充为纯色：哈希和直方图不再随其内容变化，JPEG中几乎不占空间
+    applyMasks(frame);
 
-    // 检查窗口是否过小或无效
-    if (width <= 0 || height <= 0 || width > 7680 || height > 4320) {
-        logError_fmt("无效的窗口尺寸: {}x{}", width, height);
-        return nullptr;
+    // 场景切换：探测阶段已发现，或本帧直方图相对上一检查帧大幅变化
+    bool scene_change = pending_scene_change_ || (scene_detector_.enabled() && scene_detector_.detect(frame));
+    pending_scene_change_ = false;
+    if (scene_change) {
+        logInfo_fmt("检测到场景切换，直方图距离: {:.2f}", scene_detector_.lastDistance());
     }
 
-    std::vector<uint8_t> jpeg_data;
+    // 读取关注区域设置（复制到成员快照，复用其容量）
+    RoiSettings& roi = roi_snapshot_;
+    int max_width = 0;
+    int max_height = 0;
+    {
+        std::lock_guard<std::mutex> lock(settings_mutex_);
+        roi = roi_settings_;
+        max_width = output_max_width_;
+        max_height = output_max_height_;
+    }
 
-    // 使用DXGI或fallback到GDI+
-    if (use_dxgi_ && dxgi_capture_) {
-        jpeg_data = dxgi_capture_->captureScreen(window_rect_, quality);
+    // 模拟光标所在区域：游戏窗口帧中先覆盖光标，再在变化检测中忽略
+    std::vector<FrameRect>& cursor_rects = cursor_rects_;
+    cursorMaskRects(frame, cursor_rects);
+    if (cursor_mask_paint_ && window_source_) {
+        for (const FrameRect& rect : cursor_rects) {
+            paintOverRect(frame, rect);
+        }
+    }
+
+    // 在原始像素上检测瓦片变化，无变化时跳过编码
+    DirtyTileMap& dirty_tiles = dirty_tiles_;
+    bool significant_change = change_detector_.detect(frame, dirty_tiles);
+    if (significant_change && !cursor_rects.empty()) {
+        for (const FrameRect& rect : cursor_rects) {
+            dirty_tiles.clearRect(rect);
+        }
+        significant_change = dirty_tiles.any();
+    }
+    change.motion_ratio = dirty_tiles.tileCount() > 0
+        ? static_cast<double>(dirty_tiles.dirtyCount()) / dirty_tiles.tileCount() : 0.0;
+
+    // 只发送关注区域时只关心区域内的变化
+    bool roi_only = !roi.regions.empty() && !roi.include_full;
+    if (roi_only) {
+        significant_change = std::any_of(roi.regions.begin(), roi.regions.end(),
+            [&dirty_tiles](const RoiRegion& region) { return dirty_tiles.anyInRect(region.rect); });
+    }
+    // 只发送关注区域时没有关键帧：场景切换保留到下一次发送整帧时再报告并强制关键帧
+    if (roi_only) {
+        scene_change_deferred_ = scene_change_deferred_ || scene_change;
+    }
+    else {
+        scene_change = scene_change || scene_change_deferred_;
+    }
+    bool keyframe_requested = !roi_only && (force_keyframe_.exchange(false) || scene_change);
+    significant_change = significant_change || scene_change;
+
+    // 精确哈希有变化时，再用块亮度判断变化是否只是噪声（粒子特效、UI闪烁等）
+    bool metric_computed = false;
+    if (significant_change && !scene_change && !roi_only && change_metric_.enabled()) {
+        significant_change = change_metric_.exceedsThreshold(frame);
+        metric_computed = true;
+        if (!significant_change) {
+            logDebug_fmt("帧变化低于感知阈值，距离: {}", change_metric_.lastDistance());
+        }
+    }
+
+    if (!significant_change && !keyframe_requested && last_capture_result_) {
+        // 帧无变化，重用上一帧的编码结果（结果可能仍在发送队列和飞行记录器中，不修改）
+        return last_capture_result_;
+    }
 
-        // 如果DXGI失败，fallback到GDI+
-        if (jpeg_data.empty()) {
-            use_dxgi_ = false;
-            logWarn("DXGI捕获失败，切换到GDI+捕获");
+    // 从对象池取结果（上一帧的结果仍被引用，池满时临时分配）
+    std::shared_ptr<CaptureResult> result = result_pool_.acquire();
+    if (result) {
+        result->reset();
+    }
+    else {
+        result = std::make_shared<CaptureResult>();
+    }
+    result->source_width = frame.width;
+    result->source_height = frame.height;
+    bool thumbnail = thumbnail_enabled_ && !roi_only;
+    if (thumbnail) {
+        max_width = thumbnail_max_width_;
+        max_height = thumbnail_max_height_;
+    }
+    fitSize(frame.width, frame.height, max_width, max_height, result->width, result->height);
+    result->window_rect = getWindowRect();
+    result->timestamp = std::chrono::system_clock::now();
+    result->luma_only = luma_only_;
+
+    // 决定编码为关键帧还是相对关键帧的增量帧
+    const std::vector<uint64_t>& tile_hashes = change_detector_.tileHashes();
+    bool keyframe = !roi_only && (thumbnail || !delta_enabled_ || keyframe_requested ||
+                    frames_since_keyframe_ >= keyframe_interval_ ||
+                    keyframe_hashes_.size() != tile_hashes.size());
+    int full_quality = thumbnail ? thumbnail_quality_ : (roi.full_quality > 0 ? roi.full_quality : quality);
+
+    // 缩小到服务端推理分辨率（或缩略图尺寸）后再编码
+    RawFrame encode_frame = frame;
+    if (!roi_only && (result->width != frame.width || result->height != frame.height)) {
+        encode_frame = output_resizer_.resize(frame, result->width, result->height);
+        if (!encode_frame.valid()) {
+            logError("帧缩放失败");
+            return nullptr;
         }
     }
 
-    // 如果DXGI捕获失败或未使用DXGI，尝试GDI+捕获
-    if (jpeg_data.empty()) {
-        // 创建位图
-        HBITMAP bitmap = NULL;
-        if (!captureWindowImage(bitmap, width, height)) {
-            logError("捕获窗口图像失败");
+    // 关键帧判断是否为界面画面，增量帧沿用所属关键帧的编码方式
+    result->lossless = !roi_only && (keyframe ? chooseLossless(frame, thumbnail) : lossless_keyframe_);
+    result->mixed = !roi_only && !thumbnail && !result->lossless && image_codec_ == ImageCodec::MIXED;
+
+    // 码率控制：按预测的编码大小为整帧或增量区域选择质量（无损编码和缩略图不受控制）
+    bool rate_controlled = rate_controller_.enabled() && !thumbnail && !roi_only && !result->lossless;
+    size_t frame_pixels = static_cast<size_t>(result->width) * result->height;
+
+    if (!keyframe && !roi_only) {
+        DirtyTileMap& keyframe_dirty = keyframe_dirty_;
+        keyframe_dirty.reset(frame.width, frame.height, dirty_tiles.tile_size);
+        compareTileHashes(tile_hashes, keyframe_hashes_, keyframe_dirty);
+        if (rate_controlled) {
+            // 增量区域的像素数按脏瓦片面积估计（映射到编码尺寸）
+            size_t tile_area = static_cast<size_t>(keyframe_dirty.tile_size) * keyframe_dirty.tile_size;
+            size_t dirty_pixels = static_cast<size_t>(keyframe_dirty.dirtyCount()) * tile_area * frame_pixels /
+                std::max<size_t>(static_cast<size_t>(frame.width) * frame.height, 1);
+            full_quality = rate_controller_.chooseQuality(dirty_pixels, full_quality);
+        }
+
+        if (keyframe_dirty.dirtyCount() > keyframe_dirty.tileCount() * DELTA_MAX_DIRTY_RATIO) {
+            // 变化过多，增量帧不再划算；横版场景行走时先尝试平移帧
+            bool unscaled = encode_frame.data == frame.data;
+            if (!(pan_enabled_ && unscaled && encodePan(frame, full_quality, *result))) {
+                keyframe = true;
+                result->lossless = chooseLossless(frame, thumbnail);
+            }
+        }
+        else if (!encodeDelta(encode_frame, frame.width, frame.height, full_quality, keyframe_dirty, *result)) {
+            logError("增量帧压缩失败");
+            change_detector_.reset();
+            force_keyframe_ = true;
             return nullptr;
         }
+    }
 
-        // 压缩为JPEG
-        jpeg_data = compressToJpeg(bitmap, width, height, quality);
+    if (keyframe && digest_cache_.enabled()) {
+        // 加载画面、菜单等会完全重复出现：内容与服务端已缓存的帧相同时跳过编码，只发送引用
+        // 摘要混入输出尺寸、颜色模式和编码方式，同一画面按不同参数编码时不会误用缓存
+        uint64_t seed = (static_cast<uint64_t>(result->width) << 32) | static_cast<uint32_t>(result->height);
+        seed ^= (thumbnail ? 1ULL << 63 : 0) | (result->luma_only ? 1ULL << 62 : 0) | (result->lossless ? 1ULL << 61 : 0) |
+                (result->mixed ? 1ULL << 60 : 0);
+        result->content_digest = computeFrameDigest(frame, seed);
+        result->content_cached = digest_cache_.touch(result->content_digest);
+    }
 
-        // 清理位图
-        cleanupBitmap(bitmap);
+    if (keyframe && result->content_cached) {
+        keyframe_hashes_ = tile_hashes;
+        lossless_keyframe_ = result->lossless;
+        keyframe_id_++;
+        frames_since_keyframe_ = 0;
+        logDebug_fmt("帧内容已缓存，发送引用: {}", result->content_digest.toHex());
+    }
+    else if (keyframe) {
+        // 压缩整帧
+        if (rate_controlled) {
+            full_quality = rate_controller_.chooseQuality(frame_pixels, full_quality);
+        }
+        if (!encodeKeyframe(encode_frame, full_quality, *result)) {
+            logError("图像压缩失败");
+            // 下一帧重新视为全部变化，避免漏发
+            change_detector_.reset();
+            force_keyframe_ = true;
+            return nullptr;
+        }
+
+        keyframe_hashes_ = tile_hashes;
+        lossless_keyframe_ = result->lossless;
+        keyframe_id_++;
+        frames_since_keyframe_ = 0;
+    }
+    else if (result->is_pan) {
+        // 平移结果在服务端成为新的关键帧，但它由上一帧推导而来，误差会累积：
+        // 仍计入增量帧数，持续平移时也按keyframe_interval发送完整关键帧
+        keyframe_hashes_ = tile_hashes;
+        lossless_keyframe_ = result->lossless;
+        keyframe_id_++;
+        frames_since_keyframe_++;
+    }
+    else if (!roi_only) {
+        frames_since_keyframe_++;
     }
 
-    if (jpeg_data.empty()) {
-        logError("JPEG压缩失败");
+    // 码率控制：超出目标过多时按本帧实测的复杂度降低质量重编码一次，再用最终结果更新大小预测
+    if (rate_controlled && !result->content_cached) {
+        size_t pixels = keyframe ? frame_pixels : patchPixels(result->patches);
+        int retry = result->is_pan ? 0 : rate_controller_.retryQuality(pixels, full_quality, encodedBytes(*result));
+        if (retry > 0) {
+            logDebug_fmt("帧大小 {} KB 超出目标，质量 {} -> {}", encodedBytes(*result) / 1024, full_quality, retry);
+            full_quality = retry;
+            bool encoded = keyframe ? encodeKeyframe(encode_frame, full_quality, *result)
+                : encodeDelta(encode_frame, frame.width, frame.height, full_quality, keyframe_dirty_, *result);
+            if (!encoded) {
+                logError("图像重新压缩失败");
+                change_detector_.reset();
+                force_keyframe_ = true;
+                return nullptr;
+            }
+        }
+        rate_controller_.record(pixels, full_quality, encodedBytes(*result));
+        result->quality = full_quality;
+    }
+
+    // 编码关注区域
+    if (!roi.regions.empty() && !encodeRegions(frame, roi.regions, *result)) {
+        logError("关注区域压缩失败");
+        // 关键帧/平移状态已更新但本帧不会发送：下一帧重新发送关键帧，避免增量帧引用未送达的关键帧
+        change_detector_.reset();
+        force_keyframe_ = true;
         return nullptr;
     }
 
-    // 计算当前帧的哈希值用于帧差异检测
-    size_t frame_hash = 0;
-    if (jpeg_data.size() > 0) {
-        // 简单哈希：只取JPEG的部分数据点计算
-        for (size_t i = 0; i < jpeg_data.size(); i += 64) {
-            frame_hash = frame_hash * 33 + jpeg_data[i];
+    // 以本次发送的帧作为后续感知比较的参考（场景切换、强制关键帧等跳过了阈值判断的帧同样更新）
+    if (change_metric_.enabled() && !roi_only) {
+        if (!metric_computed) {
+            change_metric_.measure(frame);
         }
+        change_metric_.commit();
     }
 
-    // 检查帧差异
-    bool significant_change = (frame_hash != last_frame_hash_);
-    last_frame_hash_ = frame_hash;
+    // 缩略图模式下保存全分辨率帧，服务端可通过frame_id拉取
+    result->frame_id = ++frame_id_;
+    if (thumbnail) {
+        frame_history_.store(result->frame_id, frame);
+    }
 
-    if (!significant_change && last_capture_result_) {
-        // 帧无明显变化，重用上一帧
-        return last_capture_result_;
+    // 保存发送的帧作为下一次平移检测的参考
+    if (pan_enabled_ && !roi_only) {
+        pan_reference_.store(result->frame_id, frame);
+        pan_reference_id_ = result->frame_id;
     }
 
-    // 创建结果
-    auto result = std::make_shared<CaptureResult>();
-    result->jpeg_data = std::move(jpeg_data);
-    result->width = width;
-    result->height = height;
-    result->window_rect = window_rect_;
-    result->timestamp = std::chrono::system_clock::now();
-    result->changed = significant_change;
+    result->scene_change = scene_change;
+    result->is_keyframe = keyframe;
+    result->keyframe_id = keyframe_id_;
+    result->roi_only = roi_only;
+    result->thumbnail = thumbnail;
+
+    // 整帧已编码，延迟的场景切换随本帧报告
+    if (!roi_only) {
+        scene_change_deferred_ = false;
+    }
 
     // 保存结果以便重用
     last_capture_result_ = result;
+    change.changed = true;
 
     return result;
 }
 
-bool ScreenCapture::captureWindowImage(HBITMAP& bitmap, int& width, int& height) {
-    // 检查窗口是否最小化
-    if (IsIconic(game_window_)) {
-        logWarn("游戏窗口已最小化，无法捕获");
+bool ScreenCapture::encodeDelta(const RawFrame& frame, int source_width, int source_height, int quality,
+                                const DirtyTileMap& keyframe_dirty, CaptureResult& result) {
+    std::vector<FrameRect>& rects = dirty_rects_;
+    mergeDirtyTiles(keyframe_dirty, source_width, source_height, rects);
+
+    result.clearPatches(result.patches);
+    result.patches.reserve(rects.size());
+    for (const FrameRect& source_rect : rects) {
+        // 脏区域在原始帧坐标中，映射到编码帧
+        FrameRect rect = scaleRect(source_rect, source_width, source_height, frame.width, frame.height);
+        if (rect.empty()) {
+            continue;
+        }
+
+        EncodedPatch patch;
+        patch.rect = rect;
+        patch.data = result.takeBuffer();
+        result.patches.push_back(std::move(patch));
+    }
+
+    // 各区域互不依赖，由编码线程池并行压缩（混合光栅的界面层先写入各区域自己的列表）
+    std::atomic<bool> failed(false);
+    patch_overlays_.resize(result.patches.size());
+    encode_workers_.parallelFor(result.patches.size(), [&](size_t i) {
+        EncodedPatch& patch = result.patches[i];
+        RawFrame crop = cropFrame(frame, patch.rect);
+        bool encoded = result.mixed
+            ? encodeMixed(crop, patch.rect.x, patch.rect.y, quality, patch.data, patch_overlays_[i])
+            : encodeImage(crop, quality, result.lossless, patch.data);
+        if (!encoded) {
+            failed = true;
+        }
+    });
+
+    result.clearPatches(result.overlays);
+    for (std::vector<EncodedPatch>& overlays : patch_overlays_) {
+        std::move(overlays.begin(), overlays.end(), std::back_inserter(result.overlays));
+        overlays.clear();
+    }
+
+    return !failed;
+}
+
+void ScreenCapture::setCursorMask(bool enabled, int size, bool paint) {
+    cursor_mask_enabled_ = enabled;
+    cursor_mask_size_ = std::min(std::max(size, 8), 256);
+    cursor_mask_paint_ = paint;
+    logInfo_fmt("光标遮罩: {}，大小: {}，覆盖光标: {}", enabled ? "启用" : "禁用",
+        cursor_mask_size_, paint ? "是" : "否");
+}
+
+void ScreenCapture::applyMasks(const RawFrame& frame) {
+    // 复制到成员快照（复用其容量），在锁外填充
+    std::vector<MaskRegion>& masks = masks_snapshot_;
+    {
+        std::lock_guard<std::mutex> lock(settings_mutex_);
+        masks = masks_;
+    }
+    fillMasks(frame, masks);
+}
+
+void ScreenCapture::cursorMaskRects(const RawFrame& frame, std::vector<FrameRect>& rects) {
+    rects.clear();
+    if (!cursor_mask_enabled_ || !has_cursor_) {
+        return;
+    }
+
+    // 屏幕坐标转换为帧内坐标，箭头热点在左上方，遮罩主要向右下延伸
+    FrameRect source_rect = frame_source_->getSourceRect();
+    int offset = cursor_mask_size_ / 4;
+    for (const POINT& pos : { cursor_pos_, last_cursor_pos_ }) {
+        FrameRect rect = clipRect({ pos.x - source_rect.x - offset, pos.y - source_rect.y - offset,
+                                    cursor_mask_size_, cursor_mask_size_ }, frame.width, frame.height);
+        if (!rect.empty()) {
+            rects.push_back(rect);
+        }
+        if (cursor_pos_.x == last_cursor_pos_.x && cursor_pos_.y == last_cursor_pos_.y) {
+            break;
+        }
+    }
+
+    last_cursor_pos_ = cursor_pos_;
+}
+
+bool ScreenCapture::probeSceneChange() {
+    if (!scene_detector_.enabled() || pending_scene_change_ || !isWindowValid()) {
+        return pending_scene_change_;
+    }
+
+    RawFrame frame;
+    if (!frame_source_->acquireFrame(frame)) {
         return false;
     }
 
-    // 创建兼容位图
-    bitmap = CreateCompatibleBitmap(window_dc_, width, height);
-    if (!bitmap) {
-        logError("创建兼容位图失败");
+    // 与captureScreen一样在遮罩后计算直方图，两处的直方图可以相互比较
+    applyMasks(frame);
+    pending_scene_change_ = scene_detector_.detect(frame);
+    return pending_scene_change_;
+}
+
+void ScreenCapture::setPanDetection(bool enabled, int max_dx, int max_dy) {
+    pan_enabled_ = enabled;
+    motion_estimator_.setSearchRange(max_dx, max_dy);
+    pan_reference_.setCapacity(enabled ? 1 : 0);
+    pan_reference_id_ = -1;
+    logInfo_fmt("平移检测: {}，搜索范围: ±{}x±{}", enabled ? "启用" : "禁用", max_dx, max_dy);
+}
+
+bool ScreenCapture::encodePan(const RawFrame& frame, int quality, CaptureResult& result) {
+    RawFrame reference;
+    if (!pan_reference_.find(pan_reference_id_, reference)) {
         return false;
     }
 
-    // 选择位图到内存DC
-    HBITMAP old_bitmap = (HBITMAP)SelectObject(memory_dc_, bitmap);
+    PanEstimate pan = motion_estimator_.estimate(frame, reference);
+    if (!pan.valid) {
+        return false;
+    }
 
-    // 尝试使用PrintWindow捕获
-    BOOL result = PrintWindow(game_window_, memory_dc_, PW_CLIENTONLY);
+    // 平移后仍不同的瓦片（含新露出的条带）作为残差区域
+    DirtyTileMap& residual = pan_residual_;
+    residual.reset(frame.width, frame.height, change_detector_.getTileSize());
+    int residual_count = computeShiftResidual(frame, reference, pan.dx, pan.dy, residual);
+    if (residual_count > residual.tileCount() * DELTA_MAX_DIRTY_RATIO) {
+        logDebug_fmt("平移({}, {})后残差过多: {}/{}", pan.dx, pan.dy, residual_count, residual.tileCount());
+        return false;
+    }
 
-    // 如果PrintWindow失败，尝试使用BitBlt
-    if (!result || GetLastError() != 0) {
-        result = BitBlt(memory_dc_, 0, 0, width, height, window_dc_, 0, 0, SRCCOPY);
+    if (!encodeDelta(frame, frame.width, frame.height, quality, residual, result)) {
+        result.clearPatches(result.patches);
+        return false;
     }
 
-    // 恢复旧位图
-    SelectObject(memory_dc_, old_bitmap);
+    result.is_pan = true;
+    result.pan_dx = pan.dx;
+    result.pan_dy = pan.dy;
+    result.pan_reference_id = pan_reference_id_;
+    logDebug_fmt("平移帧: ({}, {})，残差瓦片: {}/{}", pan.dx, pan.dy, residual_count, residual.tileCount());
+    return true;
+}
 
-    if (!result) {
-        logError_fmt("捕获窗口内容失败，错误码: {}", GetLastError());
-        DeleteObject(bitmap);
-        bitmap = NULL;
+void ScreenCapture::setThumbnailMode(bool enabled, int max_width, int max_height, int quality, int history_size) {
+    thumbnail_enabled_ = enabled;
+    thumbnail_max_width_ = std::max(max_width, 16);
+    thumbnail_max_height_ = std::max(max_height, 16);
+    thumbnail_quality_ = std::min(std::max(quality, 1), 100);
+    frame_history_.setCapacity(enabled ? static_cast<size_t>(std::max(history_size, 1)) : 0);
+    force_keyframe_ = true;
+
+    logInfo_fmt("缩略图模式: {}，缩略图: {}x{}，质量: {}，保存帧数: {}", enabled ? "启用" : "禁用",
+        thumbnail_max_width_, thumbnail_max_height_, thumbnail_quality_, frame_history_.capacity());
+}
+
+bool ScreenCapture::encodeHistoryFrame(int64_t frame_id, const FrameRect& crop, int quality, EncodedPatch& patch) {
+    RawFrame frame;
+    if (!frame_history_.find(frame_id, frame)) {
+        logWarn_fmt("帧历史中没有帧: {}", frame_id);
+        return false;
+    }
+
+    FrameRect rect = crop.empty() ? FrameRect{ 0, 0, frame.width, frame.height }
+                                  : clipRect(crop, frame.width, frame.height);
+    RawFrame source = cropFrame(frame, rect);
+    if (!source.valid()) {
+        logWarn_fmt("裁剪区域超出帧范围: ({}, {}, {}x{})", crop.x, crop.y, crop.width, crop.height);
         return false;
     }
 
+    patch.rect = rect;
+    patch.encoded_width = source.width;
+    patch.encoded_height = source.height;
+    return compressToJpeg(source, quality, patch.data);
+}
+
+void ScreenCapture::setMasks(const std::vector<MaskRegion>& masks) {
+    std::lock_guard<std::mutex> lock(settings_mutex_);
+    masks_.clear();
+    for (const MaskRegion& mask : masks) {
+        if (mask.rect.empty()) {
+            logWarn_fmt("忽略无效的遮罩区域: {}", mask.name);
+            continue;
+        }
+        masks_.push_back(mask);
+    }
+    logInfo_fmt("已更新静态区域遮罩: {} 个", masks_.size());
+}
+
+void ScreenCapture::setLumaOnly(bool enabled) {
+    if (luma_only_.exchange(enabled) == enabled) {
+        return;
+    }
+
+    // 颜色模式变化后服务端的参考帧失效
+    force_keyframe_ = true;
+    rate_controller_.reset();
+    logInfo_fmt("图像颜色模式: {}", enabled ? "灰度" : "彩色");
+}
+
+bool parseImageCodec(const std::string& name, ImageCodec& codec) {
+    if (name == "jpeg") {
+        codec = ImageCodec::JPEG;
+    }
+    else if (name == "lossless") {
+        codec = ImageCodec::LOSSLESS;
+    }
+    else if (name == "auto") {
+        codec = ImageCodec::AUTO;
+    }
+    else if (name == "mixed") {
+        codec = ImageCodec::MIXED;
+    }
+    else {
+        return false;
+    }
     return true;
 }
 
-std::vector<uint8_t> ScreenCapture::compressToJpeg(HBITMAP bitmap, int width, int height, int quality) {
-    // 创建Bitmap对象
-    Bitmap* bmp = new Bitmap(bitmap, NULL);
-    if (!bmp) {
-        logError("创建GDI+ Bitmap失败");
-        return {};
+void ScreenCapture::setImageCodec(ImageCodec codec) {
+    if (image_codec_.exchange(codec) == codec) {
+        return;
     }
 
-    // 检查位图是否有效
-    if (bmp->GetLastStatus() != Ok) {
-        logError("GDI+ Bitmap无效");
-        delete bmp;
-        return {};
+    // 当前关键帧的编码方式可能改变，立即重新发送关键帧
+    force_keyframe_ = true;
+    rate_controller_.reset();
+    const char* names[] = { "JPEG", "无损", "自动", "混合光栅" };
+    logInfo_fmt("图像编码方式: {}", names[static_cast<int>(codec)]);
+}
+
+void ScreenCapture::setFrameBudget(size_t target_bytes, int min_quality, int max_quality) {
+    rate_controller_.configure(target_bytes, min_quality, max_quality);
+    if (target_bytes > 0) {
+        logInfo_fmt("码率控制: 每帧目标 {} KB，质量范围: {}-{}", target_bytes / 1024,
+            std::min(std::max(min_quality, 1), 100), std::min(std::max(max_quality, min_quality), 100));
+    }
+    else {
+        logInfo("码率控制: 禁用，使用固定质量");
     }
+}
 
-    // 创建内存流
-    IStream* istream = nullptr;
-    HRESULT hr = CreateStreamOnHGlobal(NULL, TRUE, &istream);
-    if (FAILED(hr)) {
-        logError_fmt("创建流失败: 0x{:X}", hr);
-        delete bmp;
-        return {};
+void ScreenCapture::setMixedMaxColors(int colors) {
+    mixed_max_colors_ = std::min(std::max(colors, 2), 64);
+    logInfo_fmt("混合光栅界面块最大颜色数: {}", mixed_max_colors_);
+}
+
+bool ScreenCapture::setEncoder(const std::string& name) {
+    // 先试创建一次，确认编码器已编译进来
+    if (!createImageEncoder(name)) {
+        logError_fmt("不支持的图像编码器: {}，继续使用 {}", name, encoder_name_);
+        return false;
     }
 
-    // 获取JPEG编码器
-    CLSID jpegClsid;
-    if (GetEncoderClsid(L"image/jpeg", &jpegClsid) == -1) {
-        logError("获取JPEG编码器失败");
-        istream->Release();
-        delete bmp;
-        return {};
+    encoder_name_ = name;
+    logInfo_fmt("图像编码器: {}", encoder_name_);
+    return true;
+}
+
+void ScreenCapture::onCacheMiss(const FrameDigest& digest) {
+    // 服务端已淘汰该帧：后续相同内容重新完整编码，引用帧之后的增量帧也无法还原，立即补发关键帧
+    digest_cache_.erase(digest);
+    force_keyframe_ = true;
+    logInfo_fmt("服务端帧缓存未命中: {}", digest.toHex());
+}
+
+void ScreenCapture::setOutputResolution(int max_width, int max_height) {
+    max_width = std::max(max_width, 0);
+    max_height = std::max(max_height, 0);
+
+    std::lock_guard<std::mutex> lock(settings_mutex_);
+    if (max_width == output_max_width_ && max_height == output_max_height_) {
+        return;
     }
+    output_max_width_ = max_width;
+    output_max_height_ = max_height;
 
-    // 设置编码参数
-    EncoderParameters encoderParams;
-    encoderParams.Count = 1;
-    encoderParams.Parameter[0].Guid = EncoderQuality;
-    encoderParams.Parameter[0].Type = EncoderParameterValueTypeLong;
-    encoderParams.Parameter[0].NumberOfValues = 1;
-    ULONG qualityValue = quality;
-    encoderParams.Parameter[0].Value = &qualityValue;
+    // 编码尺寸变化后服务端的参考帧失效
+    force_keyframe_ = true;
+    logInfo_fmt("编码分辨率上限: {}x{}", max_width, max_height);
+}
 
-    // 保存为JPEG
-    Status status = bmp->Save(istream, &jpegClsid, &encoderParams);
+bool isSupportedStreamCodec(const std::string& codec) {
+    return codec == "jpeg";
+}
 
-    // 清理位图
-    delete bmp;
+void ScreenCapture::setStreams(const std::vector<CaptureStreamConfig>& streams) {
+    stream_configs_.clear();
+    stream_detectors_.clear();
+    stream_sequences_.clear();
 
-    if (status != Ok) {
-        logError_fmt("保存JPEG失败: {}", static_cast<int>(status));
-        istream->Release();
-        return {};
+    for (const CaptureStreamConfig& config : streams) {
+        if (config.rect.empty() || config.interval_ms <= 0) {
+            logWarn_fmt("忽略无效的捕获子流: {}", config.name);
+            continue;
+        }
+        if (!isSupportedStreamCodec(config.codec)) {
+            logError_fmt("忽略捕获子流 {}: 不支持的编码格式 {}", config.name, config.codec);
+            continue;
+        }
+
+        CaptureStreamConfig stream = config;
+        stream.quality = std::min(std::max(stream.quality, 1), 100);
+
+        logInfo_fmt("捕获子流 {}: ({}, {}, {}x{})，间隔: {} 毫秒，质量: {}，编码: {}",
+            stream.name, stream.rect.x, stream.rect.y, stream.rect.width, stream.rect.height,
+            stream.interval_ms, stream.quality, stream.codec);
+
+        stream_configs_.push_back(stream);
+        stream_detectors_.emplace_back(change_detector_.getTileSize());
+        stream_sequences_.push_back(0);
     }
+    stream_result_pool_.setCapacity(stream_configs_.size() * STREAM_RESULTS_PER_STREAM);
+}
 
-    // 获取数据大小
-    STATSTG stat;
-    hr = istream->Stat(&stat, STATFLAG_NONAME);
-    if (FAILED(hr)) {
-        logError_fmt("获取流状态失败: 0x{:X}", hr);
-        istream->Release();
-        return {};
+void ScreenCapture::captureStreams(const std::vector<size_t>& indices,
+                                   std::vector<std::shared_ptr<StreamCaptureResult>>& results) {
+    results.assign(indices.size(), nullptr);
+    if (indices.empty()) {
+        return;
     }
 
-    ULONG size = stat.cbSize.LowPart;
+    if (!isWindowValid()) {
+        logError("无效的游戏窗口");
+        return;
+    }
+
+    // 所有到期的子流共用同一帧
+    RawFrame frame;
+    if (!frame_source_->acquireFrame(frame)) {
+        logError_fmt("获取帧失败，帧源: {}", frame_source_->getName());
+        return;
+    }
+    applyMasks(frame);
 
-    // 分配内存
-    std::vector<uint8_t> buffer(size);
+    for (size_t i = 0; i < indices.size(); i++) {
+        size_t index = indices[i];
+        if (index >= stream_configs_.size()) {
+            continue;
+        }
 
-    // 重置位置
-    LARGE_INTEGER li = { 0 };
-    istream->Seek(li, STREAM_SEEK_SET, NULL);
+        const CaptureStreamConfig& config = stream_configs_[index];
+        RawFrame crop = cropFrame(frame, config.rect);
+        if (!crop.valid()) {
+            logWarn_fmt("捕获子流超出帧范围: {}", config.name);
+            continue;
+        }
 
-    // 读取数据
-    ULONG bytesRead;
-    hr = istream->Read(buffer.data(), size, &bytesRead);
-    if (FAILED(hr) || bytesRead != size) {
-        logError_fmt("读取流数据失败: 0x{:X}", hr);
-        istream->Release();
-        return {};
+        // 从对象池取结果（仍在发送队列中的结果被占用，池满时临时分配），复用字符串和图像缓冲区的容量
+        std::shared_ptr<StreamCaptureResult> result = stream_result_pool_.acquire();
+        if (!result) {
+            result = std::make_shared<StreamCaptureResult>();
+        }
+        result->stream = config.name;
+        result->codec = config.codec;
+        result->timestamp = std::chrono::system_clock::now();
+        result->patch.data.clear();
+
+        // 子区域无变化时不编码
+        result->changed = stream_detectors_[index].detect(crop, stream_dirty_);
+        if (result->changed) {
+            result->patch.name = config.name;
+            result->patch.rect = clipRect(config.rect, frame.width, frame.height);
+            result->patch.encoded_width = crop.width;
+            result->patch.encoded_height = crop.height;
+            if (!compressToJpeg(crop, config.quality, result->patch.data)) {
+                logError_fmt("子流 {} 压缩失败", config.name);
+                stream_detectors_[index].reset();
+                continue;
+            }
+            result->sequence = ++stream_sequences_[index];
+        }
+        else {
+            result->sequence = stream_sequences_[index];
+        }
+
+        results[i] = std::move(result);
     }
+}
 
-    // 释放流
-    istream->Release();
+bool ScreenCapture::captureBurst(const BurstSettings& settings, BurstResult& result) {
+    result.frames.clear();
+    if (settings.count <= 0) {
+        return false;
+    }
 
-    return buffer;
+    if (!isWindowValid()) {
+        logError("无效的游戏窗口");
+        return false;
+    }
+
+    std::vector<MaskRegion> masks;
+    int max_width = 0;
+    int max_height = 0;
+    {
+        std::lock_guard<std::mutex> lock(settings_mutex_);
+        masks = masks_;
+        max_width = output_max_width_;
+        max_height = output_max_height_;
+    }
+
+    // steady_clock帧时间戳换算为system_clock，服务端可与其他消息对齐
+    int64_t clock_offset_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - frameClockMicros();
+
+    // 先按间隔采集全部帧（帧源缓冲区会被下一帧覆盖，需要复制），编码推迟到采集结束，避免拉长帧间隔
+    if (burst_buffers_.size() < static_cast<size_t>(settings.count)) {
+        burst_buffers_.resize(settings.count);
+    }
+    std::vector<RawFrame> frames;
+    frames.reserve(settings.count);
+    std::vector<FrameRect> source_rects;
+    source_rects.reserve(settings.count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < settings.count; i++) {
+        std::this_thread::sleep_until(start + std::chrono::milliseconds(static_cast<int64_t>(settings.interval_ms) * i));
+
+        RawFrame frame;
+        if (!frame_source_->acquireFrame(frame)) {
+            logError_fmt("连拍获取帧失败，帧源: {}", frame_source_->getName());
+            break;
+        }
+
+        fillMasks(frame, masks);
+
+        int width = 0;
+        int height = 0;
+        fitSize(frame.width, frame.height, max_width, max_height, width, height);
+        RawFrame source = frame;
+        if (width != frame.width || height != frame.height) {
+            source = burst_resizer_.resize(frame, width, height);
+            if (!source.valid()) {
+                logError("连拍帧缩放失败");
+                break;
+            }
+        }
+
+        std::vector<uint8_t>& pixels = burst_buffers_[i];
+        size_t row_bytes = static_cast<size_t>(source.width) * 4;
+        pixels.resize(row_bytes * source.height);
+        for (int y = 0; y < source.height; y++) {
+            memcpy(pixels.data() + row_bytes * y, source.row(y), row_bytes);
+        }
+
+        RawFrame copy;
+        copy.data = pixels.data();
+        copy.stride = static_cast<int>(row_bytes);
+        copy.width = source.width;
+        copy.height = source.height;
+        copy.timestamp_us = frame.timestamp_us;
+        frames.push_back(copy);
+        source_rects.push_back({ 0, 0, frame.width, frame.height });
+    }
+
+    if (frames.empty()) {
+        return false;
+    }
+
+    // 各帧互不依赖，由常驻编码线程池并行编码（线程的编码器跨连拍保持初始化状态）
+    result.frames.resize(frames.size());
+    encode_workers_.parallelFor(frames.size(), [&](size_t i) {
+        BurstFrame& burst_frame = result.frames[i];
+        burst_frame.image.rect = source_rects[i];
+        burst_frame.image.encoded_width = frames[i].width;
+        burst_frame.image.encoded_height = frames[i].height;
+        compressToJpeg(frames[i], settings.quality, burst_frame.image.data);
+        burst_frame.offset_us = frames[i].timestamp_us - frames[0].timestamp_us;
+    });
+
+    for (const BurstFrame& burst_frame : result.frames) {
+        if (burst_frame.image.data.empty()) {
+            logError("连拍帧压缩失败");
+            result.frames.clear();
+            return false;
+        }
+    }
+
+    result.start_time_us = frames[0].timestamp_us + clock_offset_us;
+    result.window_rect = getWindowRect();
+    return true;
+}
+
+bool ScreenCapture::encodeRegions(const RawFrame& frame, const std::vector<RoiRegion>& regions,
+                                  CaptureResult& result) {
+    result.clearPatches(result.regions);
+    result.regions.reserve(regions.size());
+
+    for (const RoiRegion& region : regions) {
+        RawFrame crop = cropFrame(frame, region.rect);
+        if (!crop.valid()) {
+            logWarn_fmt("关注区域超出帧范围: {}", region.name);
+            continue;
+        }
+
+        // 按比例缩小后再编码
+        RawFrame source = crop;
+        double scale = std::min(std::max(region.scale, 0.01), 1.0);
+        if (scale < 1.0) {
+            int scaled_width = 0;
+            int scaled_height = 0;
+            scaledSize(crop.width, crop.height, scale, scaled_width, scaled_height);
+            source = roi_resizer_.resize(crop, scaled_width, scaled_height);
+            if (!source.valid()) {
+                return false;
+            }
+        }
+
+        EncodedPatch patch;
+        patch.name = region.name;
+        patch.rect = clipRect(region.rect, frame.width, frame.height);
+        patch.encoded_width = source.width;
+        patch.encoded_height = source.height;
+        patch.data = result.takeBuffer();
+        if (!compressToJpeg(source, region.quality, patch.data)) {
+            return false;
+        }
+        result.regions.push_back(std::move(patch));
+    }
+
+    return true;
+}
+
+bool ScreenCapture::encodeImage(const RawFrame& frame, int quality, bool lossless, std::vector<uint8_t>& out) {
+    if (lossless) {
+        encodeQoi(frame, luma_only_, out);
+        return !out.empty();
+    }
+    return compressToJpeg(frame, quality, out);
+}
+
+bool ScreenCapture::encodeKeyframe(const RawFrame& frame, int quality, CaptureResult& result) {
+    result.clearPatches(result.overlays);
+    return result.mixed
+        ? encodeMixed(frame, 0, 0, quality, result.jpeg_data, result.overlays)
+        : encodeImage(frame, quality, result.lossless, result.jpeg_data);
+}
+
+bool ScreenCapture::encodeMixed(const RawFrame& frame, int offset_x, int offset_y, int quality,
+                                std::vector<uint8_t>& out, std::vector<EncodedPatch>& overlays) {
+    // 分层结果和自然层副本按线程复用（增量区域由多个线程并行编码）
+    thread_local std::vector<FrameRect> ui_rects;
+    thread_local std::vector<uint8_t> natural;
+
+    findUiRects(frame, MIXED_BLOCK_SIZE, mixed_max_colors_, ui_rects);
+    if (ui_rects.empty()) {
+        return compressToJpeg(frame, quality, out);
+    }
+
+    for (const FrameRect& rect : ui_rects) {
+        EncodedPatch overlay;
+        overlay.rect = FrameRect{ rect.x + offset_x, rect.y + offset_y, rect.width, rect.height };
+        encodeQoi(cropFrame(frame, rect), luma_only_, overlay.data);
+        if (overlay.data.empty()) {
+            return false;
+        }
+        overlays.push_back(std::move(overlay));
+    }
+
+    // 自然层：复制后把界面区域填充为纯色，JPEG中几乎不占空间，服务端用界面层覆盖
+    RawFrame copy;
+    copy.stride = frame.width * 4;
+    copy.width = frame.width;
+    copy.height = frame.height;
+    natural.resize(static_cast<size_t>(copy.stride) * copy.height);
+    copy.data = natural.data();
+    for (int y = 0; y < frame.height; y++) {
+        memcpy(copy.row(y), frame.row(y), static_cast<size_t>(copy.stride));
+    }
+    for (const FrameRect& rect : ui_rects) {
+        fillRect(copy, rect, *reinterpret_cast<const uint32_t*>(frame.row(rect.y) + rect.x * 4));
+    }
+
+    logDebug_fmt("混合光栅: 界面层 {} 个区域", ui_rects.size());
+    return compressToJpeg(copy, quality, out);
+}
+
+bool ScreenCapture::chooseLossless(const RawFrame& frame, bool thumbnail) {
+    ImageCodec codec = image_codec_;
+    if (thumbnail || (codec != ImageCodec::AUTO && codec != ImageCodec::LOSSLESS)) {
+        return false;
+    }
+    if (codec == ImageCodec::LOSSLESS) {
+        return true;
+    }
+
+    // 背包、商店、对话框等界面大面积是纯色，相邻像素相同的比例远高于游戏场景
+    double ratio = flatPixelRatio(frame);
+    bool lossless = ratio >= lossless_flat_ratio_;
+    if (lossless != lossless_keyframe_) {
+        logDebug_fmt("关键帧编码: {}，平坦像素比例: {:.2f}", lossless ? "无损" : "JPEG", ratio);
+    }
+    return lossless;
 }
 
-void ScreenCapture::cleanupBitmap(HBITMAP bitmap) {
-    if (bitmap) {
-        DeleteObject(bitmap);
+bool ScreenCapture::compressToJpeg(const RawFrame& frame, int quality, std::vector<uint8_t>& out) {
+    ImageEncoder* encoder = threadEncoder(encoder_name_);
+    if (!encoder) {
+        out.clear();
+        return false;
+    }
+
+    bool luma = luma_only_;
+    int alignment = encoder->stripeAlignment(luma);
+    if (alignment > 0 && stripe_workers_.threadCount() > 1 && frame.height >= MIN_STRIPE_ROWS * 2) {
+        // 条带线程池同一时间只能由一个线程使用，被占用时（如并行编码的增量区域）直接编码
+        std::unique_lock<std::mutex> lock(stripe_mutex_, std::try_to_lock);
+        if (lock.owns_lock() && compressStripes(frame, quality, luma, alignment, out)) {
+            return true;
+        }
     }
+
+    return encoder->encode(frame, quality, luma, out);
+}
+
+bool ScreenCapture::compressStripes(const RawFrame& frame, int quality, bool luma, int alignment,
+                                    std::vector<uint8_t>& out) {
+    // 条带高度取MCU高度的整数倍，使拼接处没有填充行
+    int count = std::min(stripe_workers_.threadCount(), frame.height / MIN_STRIPE_ROWS);
+    int rows = (frame.height + count - 1) / count;
+    rows = (rows + alignment - 1) / alignment * alignment;
+    count = (frame.height + rows - 1) / rows;
+
+    stripe_buffers_.resize(count);
+    std::atomic<bool> failed(false);
+    stripe_workers_.parallelFor(static_cast<size_t>(count), [&](size_t i) {
+        int y = static_cast<int>(i) * rows;
+        RawFrame stripe = cropFrame(frame, FrameRect{ 0, y, frame.width, std::min(rows, frame.height - y) });
+        ImageEncoder* encoder = threadEncoder(encoder_name_);
+        if (!encoder || !encoder->encodeStripe(stripe, quality, luma, stripe_buffers_[i])) {
+            failed = true;
+        }
+    });
+
+    if (failed || !mergeJpegStripes(stripe_buffers_, frame.height, out)) {
+        logWarn_fmt("条带并行编码失败，改为单线程编码");
+        return false;
+    }
+    return true;
 }
 
 bool ScreenCapture::isWindowValid() const {
-    return game_window_ != NULL && IsWindow(game_window_);
+    return frame_source_ && frame_source_->isValid();
+}
+
+bool ScreenCapture::isWindowMinimized() const {
+#ifdef _WIN32
+    return window_source_ && window_source_->isMinimized();
+#else
+    return false;
+#endif
 }
 
 RECT ScreenCapture::getWindowRect() const {
-    return window_rect_;
-}
\ No newline at end of file
+#ifdef _WIN32
+    if (window_source_) {
+        return window_source_->getWindowRect();
+    }
+#endif
+
+    RECT rect = { 0, 0, 0, 0 };
+    if (frame_source_) {
+        FrameRect source_rect = frame_source_->getSourceRect();
+        rect.left = source_rect.x;
+        rect.top = source_rect.y;
+        rect.right = source_rect.x + source_rect.width;
+        rect.bottom = source_rect.y + source_rect.height;
+    }
+    return rect;
+}
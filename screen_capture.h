@@ -1,34 +1,234 @@
 #pragma once
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <cstdint>
+// ƽ̨LinuxܲԣʹWin32ֵͬĴھκ꣨LONGΪ32λ
+struct RECT {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+struct POINT {
+    int32_t x;
+    int32_t y;
+};
+#endif
 #include <string>
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include "frame_source.h"
+#include "frame_diff.h"
+#include "digest_cache.h"
+#include "rate_control.h"
+#include "image_resize.h"
+#include "frame_history.h"
+#include "motion_estimator.h"
+#include "object_pool.h"
+#include "worker_pool.h"
 
 // ǰ
 class DXGIScreenCapture;
+class WindowFrameSource;
+
+// ͼ
+struct EncodedPatch {
+    FrameRect rect;                  // ֡꣩
+    std::vector<uint8_t> data;       // JPEGͼ
+    std::string name;                // ƣע
+    int encoded_width = 0;           // ߴ磨ź
+    int encoded_height = 0;
+};
+
+// ָĹע
+struct RoiRegion {
+    std::string name;                // 
+    FrameRect rect;                  // ֡
+    int quality = 80;                // JPEG(1-100)
+    double scale = 1.0;              // ű(0,1]
+};
+
+// ƵʡͱĴСͼѪ
+struct CaptureStreamConfig {
+    std::string name;                // ƣϢеstreamֶΣ
+    FrameRect rect;                  // ֡
+    int interval_ms = 100;           // 룩
+    int quality = 80;                // (1-100)
+    std::string codec = "jpeg";      // ʽ
+};
+
+// Ƿָ֧ñʽĿǰֻjpeg
+bool isSupportedStreamCodec(const std::string& codec);
+
+// captureScreenı仯Ϣޱ仯ʱصһ֡Ĺܰѱεı仯д
+struct CaptureChange {
+    bool changed = false;            // Ƿһ֡Ա仯Ϊfalseʱصһ֡Ľ
+    double motion_ratio = 0.0;       // һ֡Ƭ
+};
+
+// 
+struct StreamCaptureResult {
+    std::string stream;              // 
+    std::string codec;               // ʽ
+    EncodedPatch patch;              // ͼ
+    int64_t sequence = 0;            // ţÿη͵
+    bool changed = true;             // ϴβǷб仯ޱ仯ʱpatchΪգ
+    std::chrono::system_clock::time_point timestamp;
+};
+
+// ̬֣仯õ򡢻ȣǰΪɫ
+struct MaskRegion {
+    std::string name;                // 
+    FrameRect rect;                  // ֡
+    uint32_t color = 0xFF000000;     // ɫ0xAARRGGBBڴеBGRA
+};
+
+// ע
+struct RoiSettings {
+    std::vector<RoiRegion> regions;  // עбΪձʾδã
+    bool include_full = true;        // Ƿͬʱ֡
+    int full_quality = 0;            // ֡JPEG0ʾʹĬ
+};
+
+// ֡ͼ
+enum class ImageCodec {
+    JPEG,                            // JPEG
+    LOSSLESS,                        // QOI
+    AUTO,                            // ؼ֡жΪƽ̹Ľ滭ʱ𣬷JPEG
+    MIXED                            // ϹդɫٵĽJPEG
+};
+
+// ƣjpeg/lossless/auto/mixedЧƷfalse
+bool parseImageCodec(const std::string& name, ImageCodec& codec);
 
 // ṹ
 struct CaptureResult {
-    std::vector<uint8_t> jpeg_data;  // JPEGͼ
-    int width;                       // 
-    int height;                      // ߶
+    std::vector<uint8_t> jpeg_data;  // ͼݣJPEGlosslessʱΪQOI
+    int width;                       // ȣߴ磩
+    int height;                      // ߶ȣߴ磩
+    int source_width = 0;            // ԭʼ֡ȣעԭʼ֡
+    int source_height = 0;           // ԭʼ֡߶
     RECT window_rect;                // ھ
     std::chrono::system_clock::time_point timestamp;  // ʱ
-    bool changed;                    // Ƿһ֡Ա仯
+    bool is_keyframe = true;         // ǷΪؼ֡jpeg_dataΪ֡
+    int keyframe_id = 0;             // ؼ֡ţ֡ΪοĹؼ֡
+    std::vector<EncodedPatch> patches; // ֡Թؼ֡仯
+    std::vector<EncodedPatch> regions; // עͼ
+    bool roi_only = false;           // ֻע֡/ݣ
+    bool scene_change = false;       // ллػȣǿΪؼ֡
+    bool is_pan = false;             // ƽ֡һ֡ƽ(pan_dx, pan_dy)patchesΪµĹؼ֡
+    int pan_dx = 0;
+    int pan_dy = 0;
+    int64_t pan_reference_id = 0;    // ƽ֡ο֡ţ֡ʹˣ
+    bool thumbnail = false;          // jpeg_dataΪͼȫֱ֡ʷУ
+    int64_t frame_id = 0;            // ֡ţڰȡȫֱ֡
+    FrameDigest content_digest;      // ؼ֡ժҪ֡ȥʱ
+    bool content_cached = false;     // ѻͬݣjpeg_dataΪգֻժҪ
+    bool luma_only = false;          // ͼΪҶȣȣJPEG
+    bool lossless = false;           // ֡ΪQOIͼ񣨹עΪJPEG
+    bool mixed = false;              // Ϲդ֡ΪJPEGȻ㣬overlays
+    std::vector<EncodedPatch> overlays; // ϹդĽ㣨QOI𣬸֮֡ϣ
+    int quality = 0;                 // ʿѡ֡/0ʾδʿƣ
+
+    // Ϊʼ״̬ԱӶظã
+    void reset();
+
+    // ȡһյı뻺ȸϴθĻ
+    std::vector<uint8_t> takeBuffer();
+
+    // бոĻtakeBuffer
+    void clearPatches(std::vector<EncodedPatch>& list);
+
+private:
+    std::vector<std::vector<uint8_t>> spare_buffers_; // ʱյ򻺳
+};
+
+// ãburstϢ
+struct BurstSettings {
+    int count = 5;                   // ֡
+    int interval_ms = 33;            // ֡룩
+    int quality = 80;                // JPEG(1-100)
+};
+
+// еĵ֡
+struct BurstFrame {
+    EncodedPatch image;              // ֡ͼrectΪԭʼ֡ߴ磩
+    int64_t offset_us = 0;           // ֡Ĳɼʱ䣨΢룩
 };
 
+// Ľ̶֡֡ͱ仯
+struct BurstResult {
+    std::vector<BurstFrame> frames;
+    int64_t start_time_us = 0;       // ֡ɼʱ䣨΢룬system_clock
+    RECT window_rect;                // ھ
+};
+
+#ifdef _WIN32
+// Ϸ֡ԴʹDXGI渴ƣʧʱ˵GDI
+class WindowFrameSource : public FrameSource {
+public:
+    WindowFrameSource();
+    ~WindowFrameSource() override;
+
+    // ڱҲʼ
+    bool initialize(const std::string& window_title);
+
+    bool acquireFrame(RawFrame& frame) override;
+    bool isValid() const override;
+    FrameRect getSourceRect() const override;
+    const char* getName() const override { return use_dxgi_ ? "dxgi" : "gdi"; }
+
+    // ȡھ
+    RECT getWindowRect() const { return window_rect_; }
+
+    // ǷС
+    bool isMinimized() const { return game_window_ && IsIconic(game_window_); }
+
+private:
+    // Ϸ
+    bool findGameWindow();
+
+    // 񴰿ͼDIBGDIʽ
+    bool captureWindowImage(int width, int height);
+
+    // ͷGDIԴ
+    void releaseGdiResources();
+
+    std::string window_title_;       // ڱ
+    HWND game_window_;               // Ϸھ
+    HDC window_dc_;                  // DC
+    HDC memory_dc_;                  // ڴDC
+    HBITMAP dib_bitmap_;             // GDIDIB
+    uint8_t* dib_bits_;              // DIBصַ
+    int dib_width_;                  // DIB
+    int dib_height_;                 // DIB߶
+    RECT window_rect_;               // ھ
+
+    bool use_dxgi_;                  // ǷʹDXGI
+    DXGIScreenCapture* dxgi_capture_; // DXGI
+    std::vector<uint8_t> dxgi_buffer_; // DXGI֡
+};
+#endif
+
 class ScreenCapture {
 public:
     ScreenCapture();
     ~ScreenCapture();
 
-    // ʼ
+    // ʼδ֡ԴʱϷ֡Դ
     bool initialize(const std::string& window_title);
 
-    // Ļ
-    std::shared_ptr<CaptureResult> captureScreen(int quality);
+    // Զ֡Դϳɡطŵȣinitialize֮ǰ
+    void setFrameSource(std::unique_ptr<FrameSource> source);
+
+    // Ļchangeرβһ֡ı仯
+    std::shared_ptr<CaptureResult> captureScreen(int quality, CaptureChange& change);
 
     // 鴰ǷЧ
     bool isWindowValid() const;
@@ -36,35 +236,230 @@ public:
     // ȡھ
     RECT getWindowRect() const;
 
+    // ϷǷСǴ֡ԴʼΪfalse
+    bool isWindowMinimized() const;
+
+    // òشС[Performance] memory_pool_sizeڶѭãȫռʱʱ
+    void setResultPoolSize(size_t size) { result_pool_.setCapacity(size); }
+
+    // ṇ̃߳߳֡ĸɶ̲߳ѹ
+    void setEncodeThreads(int count) { encode_workers_.setThreadCount(count); }
+
+    // б߳ͼˮƽָ̱߳ƴΪһJPEG<=1ʱڿʼǰã
+    void setStripeThreads(int count) { stripe_workers_.setThreadCount(count); }
+
     // С룩
     void setMinimumCaptureInterval(int ms) { minimum_capture_interval_ms_ = ms; }
 
+    // ñ仯ƬСأ
+    void setTileSize(int tile_size) { change_detector_.setTileSize(tile_size); keyframe_hashes_.clear(); }
+
+    // ø֪仯ֵȾthresholdı仯Ϊ뷢ͣ0ʾã
+    void setChangeThreshold(int threshold, int noise_floor) { change_metric_.setParameters(threshold, noise_floor); }
+
+    // ù֣仯ԹΧsizesizepaintΪʱϷظǹ꣨Ϸ֡Դ
+    void setCursorMask(bool enabled, int size, bool paint);
+
+    // ģλãĻ꣩captureScreen֮ǰ
+    void setCursorPosition(const POINT& screen_pos) { cursor_pos_ = screen_pos; has_cursor_ = true; }
+
+    // ֡루رʱÿ֡Ϊؼ֡keyframe_intervalΪؼ֮֡֡
+    void setDeltaEncoding(bool enabled, int keyframe_interval);
+
+    // һ֡Ϊؼ֡ɴ̵߳ã
+    void requestKeyframe() { force_keyframe_ = true; }
+
+    // ùע򣨿ɴ̵߳ã
+    void setRoiSettings(const RoiSettings& settings);
+
+    // óлֱֵͼL1룬0ʾã
+    void setSceneChangeThreshold(double threshold) { scene_detector_.setThreshold(threshold); }
+
+    // β֮̽ⳡлȡһ֡Ƚֱͼ
+    // trueʱһcaptureScreenǿƹؼ֡
+    bool probeSceneChange();
+
+    // ƽƼ⣺֡仯ʱԱΪ"һ֡ƽ+¶"δŵ룩
+    void setPanDetection(bool enabled, int max_dx, int max_dy);
+
+    // ͼģʽÿֻ֡ͼhistory_size֡ԭʼرڴйȡ
+    void setThumbnailMode(bool enabled, int max_width, int max_height, int quality, int history_size);
+    bool isThumbnailMode() const { return thumbnail_enabled_; }
+
+    // ֡ʷбȫֱ֡cropΪʱΪ֡֡ѱʱfalse
+    bool encodeHistoryFrame(int64_t frame_id, const FrameRect& crop, int quality, EncodedPatch& patch);
+
+    // þ̬֣ɴ̵߳ã
+    void setMasks(const std::vector<MaskRegion>& masks);
+
+    // ֡ȥأؼ֡ѻ֡ͬʱֻժҪãcache_sizeΪ0ʾã
+    void setFrameDedup(size_t cache_size) { digest_cache_.setCapacity(cache_size); }
+
+    // ȷѻժҪӦ֡ɴ̵߳ã
+    void confirmCachedFrame(const FrameDigest& digest) { digest_cache_.insert(digest); }
+
+    // ˱õ֡ڻУƳժҪ·ؼ֡ɴ̵߳ã
+    void onCacheMiss(const FrameDigest& digest);
+
+    // ȷϵժҪӺ˻״̬δ֪
+    void clearFrameCache() { digest_cache_.clear(); }
+
+    // ģʽͼתΪ8λҶȺ룬ֻҪҶķģͣɴ̵߳ã
+    void setLumaOnly(bool enabled);
+    bool isLumaOnly() const { return luma_only_; }
+
+    // ֡ı뷽ʽɴ̵߳ãһ֡ǿΪؼ֡
+    void setImageCodec(ImageCodec codec);
+    ImageCodec getImageCodec() const { return image_codec_; }
+
+    // ԶģʽжΪ滭ƽ̹ر0-1
+    void setLosslessFlatRatio(double ratio) { lossless_flat_ratio_ = ratio; }
+
+    // ÿ֡Ŀֽ֡򣬺㣩СԤѡ0ʾʹù̶ɴ̵߳ã
+    void setFrameBudget(size_t target_bytes, int min_quality, int max_quality);
+    size_t getFrameBudget() const { return rate_controller_.targetBytes(); }
+
+    // ϹդģʽжΪɫ2-64
+    void setMixedMaxColors(int colors);
+
+    // ѡͼ"turbojpeg"/"gdiplus"ʱԭòfalseڿʼǰã
+    bool setEncoder(const std::string& name);
+    const std::string& getEncoder() const { return encoder_name_; }
+
+    // ñֱޣֿ߱С0ʾԭʼֱʣɴ̵߳ã
+    void setOutputResolution(int max_width, int max_height);
+
+    // òøı仯ʷ
+    void setStreams(const std::vector<CaptureStreamConfig>& streams);
+
+    // ȡ
+    const std::vector<CaptureStreamConfig>& getStreams() const { return stream_configs_; }
+
+    // ģsettings.interval_mscount֡ȫɺ̲߳б
+    // ӦֺͱֱޣӰ֡仯֡ʷ
+    bool captureBurst(const BurstSettings& settings, BurstResult& result);
+
+    // ָͬһ֡resultsindicesһһӦʧܵΪnullptr
+    // Զأresultsɵ÷ø
+    void captureStreams(const std::vector<size_t>& indices, std::vector<std::shared_ptr<StreamCaptureResult>>& results);
+
 private:
-    // Ϸ
-    bool findGameWindow();
+    // ѹΪJPEGдout
+    bool compressToJpeg(const RawFrame& frame, int quality, std::vector<uint8_t>& out);
 
-    // 񴰿ͼGDI+ʽ
-    bool captureWindowImage(HBITMAP& bitmap, int& width, int& height);
+    // resultı뷽ʽѹ֡ʱΪQOIΪJPEG
+    bool encodeImage(const RawFrame& frame, int quality, bool lossless, std::vector<uint8_t>& out);
 
-    // ѹΪJPEG
-    std::vector<uint8_t> compressToJpeg(HBITMAP bitmap, int width, int height, int quality);
+    // ؼ֡֡resultı뷽ʽرʱϴεĽ㣩
+    bool encodeKeyframe(const RawFrame& frame, int quality, CaptureResult& result);
 
-    // λͼ
-    void cleanupBitmap(HBITMAP bitmap);
+    // Ϲդ룺ΪQOIoverlaysoffsetಿֱΪJPEGдout
+    bool encodeMixed(const RawFrame& frame, int offset_x, int offset_y, int quality,
+                     std::vector<uint8_t>& out, std::vector<EncodedPatch>& overlays);
 
-    std::string window_title_;       // ڱ
-    HWND game_window_;               // Ϸھ
-    HDC window_dc_;                  // DC
-    HDC memory_dc_;                  // ڴDC
-    RECT window_rect_;               // ھ
-    ULONG_PTR gdiplusToken_;         // GDI+
+    // ؼ֡Ƿʹ루Զģʽ°ƽ̶̹жϣͼʼΪJPEG
+    bool chooseLossless(const RawFrame& frame, bool thumbnail);
 
-    bool use_dxgi_;                  // ǷʹDXGI
-    DXGIScreenCapture* dxgi_capture_; // DXGI
+    // ˮƽбƴӣ÷stripe_mutex_ʧʱfalse
+    bool compressStripes(const RawFrame& frame, int quality, bool luma, int alignment, std::vector<uint8_t>& out);
+
+    // Թؼ֡仯ƬΪ
+    // frameΪ֡keyframe_dirtysource_widthsource_heightԭʼ֡
+    bool encodeDelta(const RawFrame& frame, int source_width, int source_height, int quality,
+                     const DirtyTileMap& keyframe_dirty, CaptureResult& result);
+
+    // ԱΪһ֡ƽ֡
+    bool encodePan(const RawFrame& frame, int quality, CaptureResult& result);
+
+    // ȡǰòΪɫд֡Դȡ֡·ʹ֮֡ǰã
+    void applyMasks(const RawFrame& frame);
+
+    // 򣨵ǰλúϴβʱλã֡꣩
+    void cursorMaskRects(const RawFrame& frame, std::vector<FrameRect>& rects);
+
+    // ע򣨰ű
+    bool encodeRegions(const RawFrame& frame, const std::vector<RoiRegion>& regions,
+                       CaptureResult& result);
+
+    std::unique_ptr<FrameSource> frame_source_; // ֡Դ
+    WindowFrameSource* window_source_; // ֡ԴΪϷʱָframe_source_
+#ifdef _WIN32
+    ULONG_PTR gdiplusToken_;         // GDI+
+#endif
 
     int64_t last_capture_time_;      // ϴβʱ
     int minimum_capture_interval_ms_; // С룩
 
-    size_t last_frame_hash_;         // һ֡ϣֵ֡⣩
+    TileChangeDetector change_detector_; // ԭʼƬ仯
+    PerceptualChangeMetric change_metric_; // ϴη֡ĸ֪仯
+    SceneChangeDetector scene_detector_; // л
+    bool pending_scene_change_;      // ̽⵽лȴһβ
+    bool scene_change_deferred_;     // ֻ͹עڼ䷢ĳлȴһη֡
+
+    bool cursor_mask_enabled_;       // Ƿù
+    int cursor_mask_size_;           // ֱ߳أ
+    bool cursor_mask_paint_;         // Ƿ֡иǹ
+    bool has_cursor_;                // Ƿ֪λ
+    POINT cursor_pos_;               // λãĻ꣩
+    POINT last_cursor_pos_;          // ϴβʱĹλ
+
+    bool delta_enabled_;             // Ƿ֡
+    int keyframe_interval_;          // ؼ֡֡
+    int frames_since_keyframe_;      // һؼ֡֡
+    int keyframe_id_;                // ǰؼ֡
+    std::atomic<bool> force_keyframe_; // һ֡ǿƹؼ֡
+    std::atomic<bool> luma_only_;    // ģʽҶȱ룩
+    std::string encoder_name_;       // ͼ
+    std::atomic<ImageCodec> image_codec_; // ֡ı뷽ʽ
+    double lossless_flat_ratio_;     // Զģʽʹƽ̹ر
+    bool lossless_keyframe_;         // ǰؼ֡Ϊ루֡ã
+    int mixed_max_colors_;           // Ϲդɫ
+    std::vector<std::vector<EncodedPatch>> patch_overlays_; // бʱĽ
+    RateController rate_controller_; // ÿֽ֡Ԥʿ
+    std::vector<uint64_t> keyframe_hashes_; // ؼ֡Ƭϣ
+
+    std::mutex settings_mutex_;      // roi_settings_masks_ͱֱ
+    RoiSettings roi_settings_;       // ע
+    std::vector<MaskRegion> masks_;  // ̬
+    int output_max_width_;           // ֱޣ0ʾƣ
+    int output_max_height_;
+    FrameResizer output_resizer_;    // ֡
+    FrameResizer roi_resizer_;       // ע
+
+    bool pan_enabled_;               // ǷƽƼ
+    MotionEstimator motion_estimator_; // ȫƽƹ
+    FrameHistory pan_reference_;     // һ֡ƽƲο
+    int64_t pan_reference_id_;       // ο֡
+
+    bool thumbnail_enabled_;         // ͼģʽ
+    int thumbnail_max_width_;        // ͼߴ
+    int thumbnail_max_height_;
+    int thumbnail_quality_;          // ͼJPEG
+    int64_t frame_id_;               // ֡
+    FrameHistory frame_history_;     // ͼģʽµԭʼ֡ʷ
+    FrameDigestCache digest_cache_;  // ѻĹؼ֡ժҪ
+
+    std::vector<CaptureStreamConfig> stream_configs_; // 
+    std::vector<TileChangeDetector> stream_detectors_; // ı仯
+    std::vector<int64_t> stream_sequences_; // ķ
+    ObjectPool<StreamCaptureResult> stream_result_pool_; // 
+    DirtyTileMap stream_dirty_;      // 仯Ƭøã
+
+    std::vector<std::vector<uint8_t>> burst_buffers_; // ֡أĸã
+    FrameResizer burst_resizer_;     // ֡
+
+    ObjectPool<CaptureResult> result_pool_; // 
+    WorkerPool encode_workers_;      // б
+    WorkerPool stripe_workers_;      // б
+    std::mutex stripe_mutex_;        // ͬһʱֻһ߳ʹ̳߳
+    std::vector<std::vector<uint8_t>> stripe_buffers_; // ı֡ã
+    DirtyTileMap dirty_tiles_;       // μƬ֡ã
+    std::vector<FrameRect> dirty_rects_; // ֡ϲΣ֡ã
+    DirtyTileMap keyframe_dirty_;    // Թؼ֡Ƭ
+    DirtyTileMap pan_residual_;      // ƽƺĲвƬ֡ã
+    std::vector<FrameRect> cursor_rects_; // εĹ
+    RoiSettings roi_snapshot_;       // βʹõĹע
+    std::vector<MaskRegion> masks_snapshot_; // βʹõ
+
     std::shared_ptr<CaptureResult> last_capture_result_; // һβ
-};
\ No newline at end of file
+};
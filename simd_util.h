@@ -0,0 +1,47 @@
+#pragma once
+
+// SIMD辅助：x86平台检测、目标属性宏和运行时CPU特性检测
+// SSE2是x86-64的基线指令集，可直接使用；AVX2需要运行时检测后再调用
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRAME_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC允许在任意函数中使用AVX2内建函数
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef FRAME_SIMD_X86
+
+// 检测CPU是否支持AVX2（同时检查操作系统是否保存YMM寄存器）
+inline bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) return false;
+        if ((_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#endif
+}
+
+#else
+
+inline bool cpuHasAvx2() { return false; }
+
+#endif
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <memory>
 #include <regex>
+#include <algorithm>
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #include <Windows.h>
@@ -180,9 +181,7 @@ void WebSocketClient::disconnect() {
     logInfo("WebSocketѹر");
 }
 
-bool WebSocketClient::sendImage(const std::vector<uint8_t>& jpeg_data,
-                               const GameState& game_state,
-                               const RECT& window_rect) {
+bool WebSocketClient::sendCapture(const CaptureResult& result, const GameState& game_state, int* request_id) {
     std::unique_lock<std::mutex> lock(send_mutex_);
 
     if (!connected_) {
@@ -190,64 +189,170 @@ bool WebSocketClient::sendImage(const std::vector<uint8_t>& jpeg_data,
         return false;
     }
 
+    const char* type = captureMessageType(result);
+
     try {
-        // Base64ͼ
-        std::string base64_image = base64_encode(jpeg_data.data(), jpeg_data.size());
+        message_buffer_.clear();
+        std::ostream json(&message_buffer_);
+        size_t total_bytes = writeCaptureMessage(json, result, game_state, ++request_id_);
 
-        // JSONϢ
-        std::ostringstream json;
+        if (!sendTextMessage(message_buffer_.str())) {
+            logError_fmt("{}Ϣʧ", type);
+            return false;
+        }
+
+        logDebug_fmt("ѷ{}: {}, ע: {}, С: {:.2f} KB, ؼ֡: {}, ID: {}",
+                  type, result.patches.size(), result.regions.size(), total_bytes / 1024.0,
+                  result.keyframe_id, request_id_);
+
+        if (request_id) {
+            *request_id = request_id_;
+        }
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        logError_fmt("{}Ϣʱ쳣: {}", type, e.what());
+        return false;
+    }
+}
+
+bool WebSocketClient::sendStream(const StreamCaptureResult& result, const RECT& window_rect) {
+    std::unique_lock<std::mutex> lock(send_mutex_);
+
+    if (!connected_) {
+        logError("WebSocketδ");
+        return false;
+    }
+
+    try {
+        message_buffer_.clear();
+        std::ostream json(&message_buffer_);
         json << "{";
-        json << "\"type\":\"image\",";
+        json << "\"type\":\"image_stream\",";
+        json << "\"stream\":";
+        writeJsonString(json, result.stream);
+        json << ",";
         json << "\"request_id\":" << ++request_id_ << ",";
+        json << "\"seq\":" << result.sequence << ",";
         json << "\"timestamp\":" << std::time(nullptr) << ",";
-        json << "\"data\":\"" << base64_image << "\",";
+        json << "\"codec\":\"" << result.codec << "\",";
+        json << "\"region\":";
+        writePatch(json, result.patch);
+        json << ",";
 
-        // Ϸ״̬
-        json << "\"game_state\":{";
-        json << "\"player_x\":" << game_state.player_x << ",";
-        json << "\"player_y\":" << game_state.player_y << ",";
-        json << "\"current_map\":\"" << game_state.current_map << "\",";
-        json << "\"hp_percent\":" << game_state.hp_percent << ",";
-        json << "\"mp_percent\":" << game_state.mp_percent << ",";
-        json << "\"inventory_full\":" << (game_state.inventory_full ? "true" : "false");
+        // Ӵھ
+        writeWindowRect(json, window_rect);
+
+        json << "}";
+
+        if (!sendTextMessage(message_buffer_.str())) {
+            logError_fmt(" {} ʧ", result.stream);
+            return false;
+        }
+
+        logDebug_fmt("ѷ {}: {}, С: {:.2f} KB",
+                  result.stream, result.sequence, result.patch.data.size() / 1024.0);
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        logError_fmt("ʱ쳣: {}", e.what());
+        return false;
+    }
+}
+
+bool WebSocketClient::sendFullFrame(int for_request_id, int64_t frame_id, const EncodedPatch* patch) {
+    std::unique_lock<std::mutex> lock(send_mutex_);
+
+    if (!connected_) {
+        logError("WebSocketδ");
+        return false;
+    }
 
-        // Ӽȴʱ
-        json << ",\"cooldowns\":{";
-        bool first_cooldown = true;
-        for (const auto& cooldown : game_state.cooldowns) {
-            if (!first_cooldown) json << ",";
-            json << "\"" << cooldown.first << "\":" << cooldown.second;
-            first_cooldown = false;
+    try {
+        message_buffer_.clear();
+        std::ostream json(&message_buffer_);
+        json << "{";
+        json << "\"type\":\"full_frame\",";
+        json << "\"request_id\":" << ++request_id_ << ",";
+        json << "\"for_request_id\":" << for_request_id << ",";
+        json << "\"frame_id\":" << frame_id << ",";
+        json << "\"timestamp\":" << std::time(nullptr) << ",";
+        if (patch) {
+            json << "\"region\":";
+            writePatch(json, *patch);
+        }
+        else {
+            json << "\"error\":\"frame_not_found\"";
         }
         json << "}";
 
-        json << "},";
+        if (!sendTextMessage(message_buffer_.str())) {
+            logError("ȫֱ֡ʧ");
+            return false;
+        }
+
+        logDebug_fmt("ѷȫֱ֡֡: {}, С: {:.2f} KB, ID: {}",
+                  frame_id, patch ? patch->data.size() / 1024.0 : 0.0, request_id_);
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        logError_fmt("ȫֱ֡ʱ쳣: {}", e.what());
+        return false;
+    }
+}
+
+bool WebSocketClient::sendBurst(const BurstResult& result, int for_request_id) {
+    std::unique_lock<std::mutex> lock(send_mutex_);
+
+    if (!connected_) {
+        logError("WebSocketδ");
+        return false;
+    }
+
+    try {
+        message_buffer_.clear();
+        std::ostream json(&message_buffer_);
+        size_t total_bytes = 0;
+        json << "{";
+        json << "\"type\":\"image_burst\",";
+        json << "\"request_id\":" << ++request_id_ << ",";
+        json << "\"for_request_id\":" << for_request_id << ",";
+        json << "\"timestamp\":" << std::time(nullptr) << ",";
+        json << "\"start_time_us\":" << result.start_time_us << ",";
+
+        // ÿ֡Ϊ֡t_usΪ֡Ĳɼʱ
+        json << "\"frames\":[";
+        for (size_t i = 0; i < result.frames.size(); i++) {
+            if (i > 0) json << ",";
+            json << "{\"index\":" << i << ",";
+            json << "\"t_us\":" << result.frames[i].offset_us << ",";
+            json << "\"image\":";
+            writePatch(json, result.frames[i].image);
+            json << "}";
+            total_bytes += result.frames[i].image.data.size();
+        }
+        json << "],";
 
         // Ӵھ
-        json << "\"window_rect\":["
-             << window_rect.left << ","
-             << window_rect.top << ","
-             << window_rect.right << ","
-             << window_rect.bottom
-             << "]";
+        writeWindowRect(json, result.window_rect);
 
         json << "}";
 
-        std::string message = json.str();
-
-        // WebSocketϢ
-        if (!sendTextMessage(message)) {
-            logError("ͼʧ");
+        if (!sendTextMessage(message_buffer_.str())) {
+            logError("ʧ");
             return false;
         }
 
-        logDebug_fmt("ѷͼʶͼС: {:.2f} KB, ID: {}",
-                  jpeg_data.size() / 1024.0, request_id_);
+        logDebug_fmt("ѷģ֡: {}, С: {:.2f} KB, ID: {}",
+                  result.frames.size(), total_bytes / 1024.0, request_id_);
 
         return true;
     }
     catch (const std::exception& e) {
-        logError_fmt("ͼʱ쳣: {}", e.what());
+        logError_fmt("ʱ쳣: {}", e.what());
         return false;
     }
 }
@@ -257,6 +362,11 @@ void WebSocketClient::setMessageCallback(std::function<void(const std::string&)>
     message_callback_ = callback;
 }
 
+void WebSocketClient::setSendCallback(std::function<void(const std::string&)> callback) {
+    std::unique_lock<std::mutex> lock(callback_mutex_);
+    send_callback_ = callback;
+}
+
 bool WebSocketClient::isConnected() const {
     return connected_;
 }
@@ -279,7 +389,9 @@ void WebSocketClient::sendHeartbeat(const GameState& game_state) {
         json << "\"game_state\":{";
         json << "\"player_x\":" << game_state.player_x << ",";
         json << "\"player_y\":" << game_state.player_y << ",";
-        json << "\"current_map\":\"" << game_state.current_map << "\",";
+        json << "\"current_map\":";
+        writeJsonString(json, game_state.current_map);
+        json << ",";
         json << "\"hp_percent\":" << game_state.hp_percent << ",";
         json << "\"mp_percent\":" << game_state.mp_percent << ",";
         json << "\"inventory_full\":" << (game_state.inventory_full ? "true" : "false");
@@ -520,6 +632,9 @@ std::string WebSocketClient::calculateAcceptKey(const std::string& websocket_key
 }
 
 bool WebSocketClient::sendTextMessage(const std::string& message) {
+    if (send_callback_) {
+        send_callback_(message);
+    }
     return sendWebSocketFrame(WS_OPCODE_TEXT, message.data(), message.size());
 }
 
@@ -542,48 +657,28 @@ bool WebSocketClient::sendWebSocketFrame(uint8_t opcode, const void* data, size_
         return false;
     }
 
-    // ֡С
-    size_t frame_size = 2; // ͷ
-
-    if (length <= 125) {
-        // 7λ
-    }
-    else if (length <= 65535) {
-        // 16λ
-        frame_size += 2;
-    }
-    else {
-        // 64λ
-        frame_size += 8;
-    }
-
-    // 
-    frame_size += 4; // 
-
-    // Ӹ
-    frame_size += length;
-
-    // ֡
-    std::vector<uint8_t> frame(frame_size, 0);
+    // ֡ͷ뻯ĸطֿдջϻͣΪ֡ڴ
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+    uint8_t buffer[16384];
     size_t pos = 0;
 
     // FIN + opcode (һֽ)
-    frame[pos++] = WS_FIN | (opcode & 0x0F);
+    buffer[pos++] = WS_FIN | (opcode & 0x0F);
 
     // MASK + س (ڶֽ)
     if (length <= 125) {
-        frame[pos++] = WS_MASK | (uint8_t)length;
+        buffer[pos++] = WS_MASK | (uint8_t)length;
     }
     else if (length <= 65535) {
-        frame[pos++] = WS_MASK | 126;
-        frame[pos++] = (length >> 8) & 0xFF;
-        frame[pos++] = length & 0xFF;
+        buffer[pos++] = WS_MASK | 126;
+        buffer[pos++] = (length >> 8) & 0xFF;
+        buffer[pos++] = length & 0xFF;
     }
     else {
-        frame[pos++] = WS_MASK | 127;
+        buffer[pos++] = WS_MASK | 127;
         // 64λ (ֽ/)
         for (int i = 7; i >= 0; i--) {
-            frame[pos++] = (length >> (i * 8)) & 0xFF;
+            buffer[pos++] = (length >> (i * 8)) & 0xFF;
         }
     }
 
@@ -594,28 +689,32 @@ bool WebSocketClient::sendWebSocketFrame(uint8_t opcode, const void* data, size_
     }
 
     // 
-    memcpy(&frame[pos], mask, 4);
+    memcpy(&buffer[pos], mask, 4);
     pos += 4;
 
-    // Ʋ뻯
-    if (data && length > 0) {
-        const uint8_t* payload = static_cast<const uint8_t*>(data);
-        for (size_t i = 0; i < length; i++) {
-            frame[pos++] = payload[i] ^ mask[i % 4];
+    // 뻯ݲֿ鷢
+    const uint8_t* payload = static_cast<const uint8_t*>(data);
+    size_t offset = 0;
+    do {
+        size_t chunk = std::min(length - offset, sizeof(buffer) - pos);
+        for (size_t i = 0; i < chunk; i++) {
+            buffer[pos++] = payload[offset + i] ^ mask[(offset + i) % 4];
         }
-    }
+        offset += chunk;
+
+        // ֡
+        size_t bytes_sent = 0;
+        while (bytes_sent < pos) {
+            int result = send(websocket_, (const char*)&buffer[bytes_sent], (int)(pos - bytes_sent), 0);
+            if (result == SOCKET_ERROR) {
+                logError_fmt("WebSocket֡ʧܣ: {}", WSAGetLastError());
+                return false;
+            }
 
-    // ֡
-    size_t bytes_sent = 0;
-    while (bytes_sent < frame_size) {
-        int result = send(websocket_, (const char*)&frame[bytes_sent], (int)(frame_size - bytes_sent), 0);
-        if (result == SOCKET_ERROR) {
-            logError_fmt("WebSocket֡ʧܣ: {}", WSAGetLastError());
-            return false;
+            bytes_sent += result;
         }
-
-        bytes_sent += result;
-    }
+        pos = 0;
+    } while (offset < length);
 
     return true;
 }
@@ -11,17 +11,9 @@
 #include <vector>
 #include <thread>
 #include <unordered_map>
-
-// 简化的GameState
-struct GameState {
-    int player_x = 0;
-    int player_y = 0;
-    std::string current_map = "";
-    float hp_percent = 100.0f;
-    float mp_percent = 100.0f;
-    bool inventory_full = false;
-    std::unordered_map<std::string, float> cooldowns;
-};
+#include <sstream>
+#include <streambuf>
+#include "capture_message.h"
 
 // WebSocket帧结构
 struct WebSocketFrame {
@@ -42,13 +34,25 @@ public:
     // 断开连接
     void disconnect();
 
-    // 发送图像和游戏状态
-    bool sendImage(const std::vector<uint8_t>& jpeg_data, const GameState& game_state,
-        const RECT& window_rect);
+    // 发送捕获结果：关键帧(image)、增量帧(image_delta)或仅关注区域(image_roi)
+    // request_id非空时返回本条消息的请求ID
+    bool sendCapture(const CaptureResult& result, const GameState& game_state, int* request_id = nullptr);
+
+    // 响应服务端的全分辨率帧请求（full_frame），patch为空表示帧已不在历史中
+    bool sendFullFrame(int for_request_id, int64_t frame_id, const EncodedPatch* patch);
+
+    // 发送捕获子流图像（image_stream，以stream字段区分子流）
+    bool sendStream(const StreamCaptureResult& result, const RECT& window_rect);
+
+    // 发送连拍结果（image_burst，各帧带相对首帧的采集时间），for_request_id为服务端burst消息的请求ID
+    bool sendBurst(const BurstResult& result, int for_request_id);
 
     // 设置消息回调函数
     void setMessageCallback(std::function<void(const std::string&)> callback);
 
+    // 设置发送回调函数（每条文本消息发送前在发送线程中调用，需在connect之前设置）
+    void setSendCallback(std::function<void(const std::string&)> callback);
+
     // 检查是否已连接
     bool isConnected() const;
 
@@ -110,9 +114,12 @@ private:
     bool verify_ssl_;
 
     std::function<void(const std::string&)> message_callback_;
+    std::function<void(const std::string&)> send_callback_;
     std::atomic<bool> connected_;
     std::atomic<bool> running_;
     std::mutex send_mutex_;
+    std::mutex socket_mutex_;        // 保证分块发送的帧不与其他线程的帧（如Pong）交错
+    MessageBuffer message_buffer_;   // 图像消息缓冲区（由send_mutex_保护）
     std::mutex callback_mutex_;
     int request_id_;
 
@@ -0,0 +1,95 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool()
+    : task_function_(nullptr), task_context_(nullptr), task_count_(0), next_index_(0), busy_workers_(0), generation_(0), stopping_(false) {
+}
+
+WorkerPool::~WorkerPool() {
+    stopThreads();
+}
+
+void WorkerPool::setThreadCount(int count) {
+    stopThreads();
+
+    stopping_ = false;
+    for (int i = 1; i < count; i++) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this, generation_);
+    }
+}
+
+void WorkerPool::stopThreads() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (std::thread& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+void WorkerPool::run(size_t count, TaskFunction function, const void* context) {
+    if (count == 0) {
+        return;
+    }
+
+    // 单线程或只有一个任务时直接在调用线程执行
+    if (threads_.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+            function(context, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_function_ = function;
+        task_context_ = context;
+        task_count_ = count;
+        next_index_ = 0;
+        busy_workers_ = threads_.size();
+        generation_++;
+    }
+    work_cv_.notify_all();
+
+    // 调用线程也参与执行
+    runTasks();
+
+    // 等待所有工作线程结束本轮，task在返回后失效
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+    task_function_ = nullptr;
+    task_context_ = nullptr;
+}
+
+void WorkerPool::runTasks() {
+    for (size_t i = next_index_++; i < task_count_; i = next_index_++) {
+        task_function_(task_context_, i);
+    }
+}
+
+void WorkerPool::workerLoop(uint64_t start_generation) {
+    uint64_t seen_generation = start_generation;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_workers_--;
+        }
+        done_cv_.notify_one();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻工作线程池：parallelFor把[0, count)的下标分给各线程（含调用线程）执行，全部完成后返回
+// 线程在setThreadCount时创建，之后每次调用不再创建线程
+class WorkerPool {
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    // 设置总线程数（含调用线程），<=1时parallelFor在调用线程上顺序执行
+    void setThreadCount(int count);
+    int threadCount() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // 并行执行task(0..count-1)，同一时间只能由一个线程调用
+    // task按引用传递，不复制闭包也不分配内存（std::function对较大的闭包会在堆上分配）
+    template <typename Task>
+    void parallelFor(size_t count, const Task& task) {
+        run(count, &invokeTask<Task>, &task);
+    }
+
+private:
+    // 任务的调用入口：context指向调用方的闭包
+    using TaskFunction = void (*)(const void* context, size_t index);
+
+    template <typename Task>
+    static void invokeTask(const void* context, size_t index) {
+        (*static_cast<const Task*>(context))(index);
+    }
+
+    // 分发任务并等待全部完成
+    void run(size_t count, TaskFunction function, const void* context);
+
+    // 工作线程循环，start_generation为创建时的任务轮次
+    void workerLoop(uint64_t start_generation);
+
+    // 领取并执行下标，直到全部领取完
+    void runTasks();
+
+    // 停止并回收全部工作线程
+    void stopThreads();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;    // 有新任务或需要退出
+    std::condition_variable done_cv_;    // 工作线程完成本轮任务
+    TaskFunction task_function_;         // 当前任务（parallelFor期间有效）
+    const void* task_context_;
+    size_t task_count_;                  // 当前任务的下标数
+    std::atomic<size_t> next_index_;     // 下一个待领取的下标
+    size_t busy_workers_;                // 仍在执行本轮任务的工作线程数
+    uint64_t generation_;                // 任务轮次，工作线程据此判断是否有新任务
+    bool stopping_;
+};
@@ -0,0 +1,344 @@
+#include "x11_frame_source.h"
+#include "LogWrapper.h"
+#include <cstring>
+#include <vector>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace {
+
+// 统计周期（微秒）
+constexpr int64_t STATS_PERIOD_US = 5000000;
+
+// X请求的错误是异步上报的，默认处理函数会直接退出进程
+// 安装自定义处理函数记录错误码，调用方在XSync/XShmGetImage之后检查
+int g_x11_error = 0;
+
+int recordX11Error(Display*, XErrorEvent* event) {
+    g_x11_error = event->error_code;
+    return 0;
+}
+
+// 读取窗口标题：优先_NET_WM_NAME（UTF-8），其次WM_NAME
+std::string getWindowTitle(Display* display, Window window) {
+    Atom net_wm_name = XInternAtom(display, "_NET_WM_NAME", True);
+    Atom utf8_string = XInternAtom(display, "UTF8_STRING", True);
+    if (net_wm_name != None && utf8_string != None) {
+        Atom actual_type = None;
+        int actual_format = 0;
+        unsigned long item_count = 0;
+        unsigned long bytes_after = 0;
+        unsigned char* value = nullptr;
+        if (XGetWindowProperty(display, window, net_wm_name, 0, 1024, False, utf8_string,
+                &actual_type, &actual_format, &item_count, &bytes_after, &value) == Success && value) {
+            std::string title(reinterpret_cast<char*>(value), item_count);
+            XFree(value);
+            if (!title.empty()) {
+                return title;
+            }
+        }
+    }
+
+    char* name = nullptr;
+    if (XFetchName(display, window, &name) && name) {
+        std::string title(name);
+        XFree(name);
+        return title;
+    }
+    return "";
+}
+
+// 递归收集可见窗口及其标题（按层级顺序）
+void collectWindows(Display* display, Window window, std::vector<std::pair<Window, std::string>>& windows) {
+    XWindowAttributes attributes;
+    if (XGetWindowAttributes(display, window, &attributes) && attributes.map_state == IsViewable) {
+        std::string title = getWindowTitle(display, window);
+        if (!title.empty()) {
+            windows.emplace_back(window, title);
+        }
+    }
+
+    Window root = 0;
+    Window parent = 0;
+    Window* children = nullptr;
+    unsigned int child_count = 0;
+    if (!XQueryTree(display, window, &root, &parent, &children, &child_count)) {
+        return;
+    }
+    for (unsigned int i = 0; i < child_count; i++) {
+        collectWindows(display, children[i], windows);
+    }
+    if (children) {
+        XFree(children);
+    }
+}
+
+} // namespace
+
+struct X11FrameSource::X11State {
+    Display* display = nullptr;
+    Window window = 0;
+    XImage* image = nullptr;
+    XShmSegmentInfo shm_info;
+    bool shm_attached = false;
+    int image_width = 0;
+    int image_height = 0;
+};
+
+X11FrameSource::X11FrameSource()
+    : x11_(std::make_unique<X11State>()),
+      stats_start_us_(0), stats_frames_(0), stats_total_us_(0), stats_max_us_(0) {
+    memset(&x11_->shm_info, 0, sizeof(x11_->shm_info));
+    x11_->shm_info.shmid = -1;
+}
+
+X11FrameSource::~X11FrameSource() {
+    releaseSharedImage();
+    if (x11_->display) {
+        XCloseDisplay(x11_->display);
+    }
+}
+
+bool X11FrameSource::initialize(const std::string& window_title, const std::string& display) {
+    window_title_ = window_title;
+
+    releaseSharedImage();
+    if (!x11_->display) {
+        x11_->display = XOpenDisplay(display.empty() ? nullptr : display.c_str());
+        if (!x11_->display) {
+            logError_fmt("无法连接X服务器: {}", display.empty() ? "$DISPLAY" : display);
+            return false;
+        }
+        XSetErrorHandler(recordX11Error);
+    }
+
+    if (!XShmQueryExtension(x11_->display)) {
+        logError("X服务器不支持MIT-SHM扩展");
+        return false;
+    }
+
+    if (!findGameWindow()) {
+        logError_fmt("找不到游戏窗口: {}", window_title);
+        return false;
+    }
+
+    stats_start_us_ = frameClockMicros();
+    total_stats_ = CaptureStats();
+    return true;
+}
+
+bool X11FrameSource::findGameWindow() {
+    x11_->window = 0;
+
+    std::vector<std::pair<Window, std::string>> windows;
+    collectWindows(x11_->display, DefaultRootWindow(x11_->display), windows);
+
+    // 先尝试精确匹配，再尝试部分匹配
+    for (const auto& window : windows) {
+        if (window.second == window_title_) {
+            x11_->window = window.first;
+            logInfo_fmt("找到精确匹配窗口: {}", window.second);
+            break;
+        }
+    }
+    if (!x11_->window) {
+        for (const auto& window : windows) {
+            if (window.second.find(window_title_) != std::string::npos) {
+                x11_->window = window.first;
+                logInfo_fmt("找到部分匹配窗口: {}", window.second);
+                break;
+            }
+        }
+    }
+
+    if (!x11_->window) {
+        return false;
+    }
+
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(x11_->display, x11_->window, &attributes)) {
+        x11_->window = 0;
+        return false;
+    }
+
+    // XShmGetImage的像素格式与窗口一致，只支持小端的32位TrueColor（BGRX）
+    if (attributes.depth != 24 && attributes.depth != 32) {
+        logError_fmt("不支持的窗口色深: {}", attributes.depth);
+        x11_->window = 0;
+        return false;
+    }
+
+    logInfo_fmt("找到游戏窗口，XID: 0x{:X}, 大小: {}x{}",
+        static_cast<unsigned long>(x11_->window), attributes.width, attributes.height);
+
+    return true;
+}
+
+bool X11FrameSource::createSharedImage(int width, int height) {
+    if (x11_->image && x11_->image_width == width && x11_->image_height == height) {
+        return true;
+    }
+
+    releaseSharedImage();
+
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(x11_->display, x11_->window, &attributes)) {
+        return false;
+    }
+
+    XImage* image = XShmCreateImage(x11_->display, attributes.visual, attributes.depth, ZPixmap,
+        nullptr, &x11_->shm_info, width, height);
+    if (!image) {
+        logError("创建共享内存图像失败");
+        return false;
+    }
+    if (image->bits_per_pixel != 32 || image->byte_order != LSBFirst) {
+        logError_fmt("不支持的图像格式: {}位, 字节序: {}", image->bits_per_pixel, image->byte_order);
+        XDestroyImage(image);
+        return false;
+    }
+
+    x11_->shm_info.shmid = shmget(IPC_PRIVATE, static_cast<size_t>(image->bytes_per_line) * image->height,
+        IPC_CREAT | 0600);
+    if (x11_->shm_info.shmid < 0) {
+        logError("分配共享内存失败");
+        XDestroyImage(image);
+        return false;
+    }
+
+    x11_->shm_info.shmaddr = image->data = static_cast<char*>(shmat(x11_->shm_info.shmid, nullptr, 0));
+    if (x11_->shm_info.shmaddr == reinterpret_cast<char*>(-1)) {
+        logError("映射共享内存失败");
+        shmctl(x11_->shm_info.shmid, IPC_RMID, nullptr);
+        x11_->shm_info.shmid = -1;
+        image->data = nullptr;
+        XDestroyImage(image);
+        return false;
+    }
+    x11_->shm_info.readOnly = False;
+    x11_->image = image;
+
+    // 连接X服务器后即可标记删除，两端都分离时系统自动回收
+    g_x11_error = 0;
+    XShmAttach(x11_->display, &x11_->shm_info);
+    XSync(x11_->display, False);
+    shmctl(x11_->shm_info.shmid, IPC_RMID, nullptr);
+    if (g_x11_error) {
+        logError_fmt("X服务器连接共享内存失败，错误码: {}", g_x11_error);
+        releaseSharedImage();
+        return false;
+    }
+    x11_->shm_attached = true;
+
+    x11_->image_width = width;
+    x11_->image_height = height;
+    return true;
+}
+
+void X11FrameSource::releaseSharedImage() {
+    if (x11_->shm_attached) {
+        XShmDetach(x11_->display, &x11_->shm_info);
+        XSync(x11_->display, False);
+        x11_->shm_attached = false;
+    }
+    if (x11_->image) {
+        // 像素在共享内存中，由shmdt释放
+        x11_->image->data = nullptr;
+        XDestroyImage(x11_->image);
+        x11_->image = nullptr;
+    }
+    if (x11_->shm_info.shmaddr && x11_->shm_info.shmaddr != reinterpret_cast<char*>(-1)) {
+        shmdt(x11_->shm_info.shmaddr);
+    }
+    x11_->shm_info.shmaddr = nullptr;
+    x11_->shm_info.shmid = -1;
+    x11_->image_width = 0;
+    x11_->image_height = 0;
+}
+
+bool X11FrameSource::acquireFrame(RawFrame& frame) {
+    if (!isValid()) {
+        return false;
+    }
+
+    XWindowAttributes attributes;
+    g_x11_error = 0;
+    if (!XGetWindowAttributes(x11_->display, x11_->window, &attributes) || g_x11_error) {
+        logError("游戏窗口已关闭");
+        x11_->window = 0;
+        releaseSharedImage();
+        return false;
+    }
+    if (attributes.map_state != IsViewable) {
+        // 窗口最小化或隐藏时无法读取内容
+        return false;
+    }
+
+    // 更新窗口位置
+    Window child = 0;
+    int root_x = 0;
+    int root_y = 0;
+    XTranslateCoordinates(x11_->display, x11_->window, attributes.root, 0, 0, &root_x, &root_y, &child);
+    source_rect_ = { root_x, root_y, attributes.width, attributes.height };
+
+    if (!createSharedImage(attributes.width, attributes.height)) {
+        return false;
+    }
+
+    int64_t start_us = frameClockMicros();
+    g_x11_error = 0;
+    if (!XShmGetImage(x11_->display, x11_->window, x11_->image, 0, 0, AllPlanes) || g_x11_error) {
+        logError_fmt("XShmGetImage失败，错误码: {}", g_x11_error);
+        return false;
+    }
+    int64_t end_us = frameClockMicros();
+    recordCapture(end_us - start_us);
+
+    frame.data = reinterpret_cast<uint8_t*>(x11_->image->data);
+    frame.stride = x11_->image->bytes_per_line;
+    frame.width = x11_->image_width;
+    frame.height = x11_->image_height;
+    frame.timestamp_us = end_us;
+    return true;
+}
+
+void X11FrameSource::recordCapture(int64_t latency_us) {
+    stats_frames_++;
+    stats_total_us_ += latency_us;
+    if (latency_us > stats_max_us_) {
+        stats_max_us_ = latency_us;
+    }
+    total_stats_.frames++;
+    total_stats_.total_us += latency_us;
+    if (latency_us > total_stats_.max_us) {
+        total_stats_.max_us = latency_us;
+    }
+
+    int64_t now_us = frameClockMicros();
+    int64_t elapsed_us = now_us - stats_start_us_;
+    if (elapsed_us < STATS_PERIOD_US) {
+        return;
+    }
+
+    logInfo_fmt("X11捕获: {:.1f} fps, 平均延迟: {:.2f} ms, 最长延迟: {:.2f} ms, 尺寸: {}x{}",
+        stats_frames_ * 1000000.0 / elapsed_us, stats_total_us_ / 1000.0 / stats_frames_,
+        stats_max_us_ / 1000.0, x11_->image_width, x11_->image_height);
+
+    stats_start_us_ = now_us;
+    stats_frames_ = 0;
+    stats_total_us_ = 0;
+    stats_max_us_ = 0;
+}
+
+bool X11FrameSource::isValid() const {
+    return x11_->display && x11_->window;
+}
+
+FrameRect X11FrameSource::getSourceRect() const {
+    return source_rect_;
+}
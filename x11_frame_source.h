@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "frame_source.h"
+
+// X11帧源：通过MIT-SHM共享内存获取窗口图像（Linux下的Wine/Proton游戏主机和Xvfb测试环境）
+// 帧直接指向共享内存中的XImage（零拷贝），要求24/32位深度的TrueColor窗口（内存布局为BGRX）
+// Xlib头文件的宏（Status、None、Bool等）会与项目代码冲突，因此X11状态只在实现文件中定义
+class X11FrameSource : public FrameSource {
+public:
+    // 捕获统计（XShmGetImage耗时，自initialize起累计）
+    struct CaptureStats {
+        int64_t frames = 0;          // 捕获帧数
+        int64_t total_us = 0;        // 总耗时（微秒）
+        int64_t max_us = 0;          // 最长耗时（微秒）
+    };
+
+    X11FrameSource();
+    ~X11FrameSource() override;
+
+    // 连接X服务器（display为空时使用DISPLAY环境变量），按窗口标题查找窗口
+    bool initialize(const std::string& window_title, const std::string& display = "");
+
+    bool acquireFrame(RawFrame& frame) override;
+    bool isValid() const override;
+    FrameRect getSourceRect() const override;
+    const char* getName() const override { return "x11shm"; }
+
+    // 获取累计捕获统计（与周期性日志使用相同的计时）
+    const CaptureStats& getCaptureStats() const { return total_stats_; }
+
+private:
+    struct X11State;
+
+    // 查找标题精确匹配或包含window_title_的窗口
+    bool findGameWindow();
+
+    // 按窗口尺寸创建共享内存图像（尺寸不变时复用）
+    bool createSharedImage(int width, int height);
+
+    // 释放共享内存图像
+    void releaseSharedImage();
+
+    // 统计捕获耗时，每隔一段时间输出帧率和延迟
+    void recordCapture(int64_t latency_us);
+
+    std::string window_title_;       // 窗口标题
+    std::unique_ptr<X11State> x11_;  // Xlib连接、窗口和共享内存图像
+    FrameRect source_rect_;          // 窗口在根窗口中的位置
+
+    int64_t stats_start_us_;         // 当前统计周期开始时间
+    int64_t stats_frames_;           // 统计周期内的帧数
+    int64_t stats_total_us_;         // 统计周期内XShmGetImage总耗时
+    int64_t stats_max_us_;           // 统计周期内XShmGetImage最长耗时
+    CaptureStats total_stats_;       // 自initialize起的累计统计
+};